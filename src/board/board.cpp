@@ -2,9 +2,65 @@
 #include <sstream>
 #include <cassert>
 #include <cstdint>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
 #include "board/board.h"
 #include <iostream>
 
+struct ZobristKeys
+{
+    uint64_t pieces[2][6][64];
+    uint64_t castling[16];
+    uint64_t enPassantFile[8];
+    uint64_t sideToMove;
+};
+
+// splitmix64 with a fixed seed so keys are identical between runs
+static uint64_t nextRandom(uint64_t &seed)
+{
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static ZobristKeys generateZobristKeys()
+{
+    ZobristKeys keys{};
+    uint64_t seed = 0x5EEDC0FFEE123456ULL;
+
+    for (auto &color : keys.pieces)
+        for (auto &type : color)
+            for (uint64_t &sq : type)
+                sq = nextRandom(seed);
+
+    for (uint64_t &c : keys.castling)
+        c = nextRandom(seed);
+
+    for (uint64_t &f : keys.enPassantFile)
+        f = nextRandom(seed);
+
+    keys.sideToMove = nextRandom(seed);
+    return keys;
+}
+
+static const ZobristKeys zobrist = generateZobristKeys();
+
+static uint64_t pieceKey(Piece p, int sq)
+{
+    size_t color = (p.color == Color::White) ? 0 : 1;
+    size_t type = static_cast<size_t>(p.type) - 1;
+    return zobrist.pieces[color][type][static_cast<size_t>(sq)];
+}
+
+static uint64_t castlingKey(const CastlingAllowed &castling)
+{
+    size_t index = (castling.whiteKingSide ? 1u : 0u) | (castling.whiteQueenSide ? 2u : 0u) |
+                   (castling.blackKingSide ? 4u : 0u) | (castling.blackQueenSide ? 8u : 0u);
+    return zobrist.castling[index];
+}
+
 int Board::coordsToIndex(std::string coords)
 {
     char file = coords[0];
@@ -42,6 +98,16 @@ int Board::coordsToIndex(std::string coords)
     return square;
 }
 
+bool operator==(const Move &a, const Move &b)
+{
+    return a.from == b.from && a.to == b.to && a.type == b.type && a.promotion == b.promotion;
+}
+
+bool operator!=(const Move &a, const Move &b)
+{
+    return !(a == b);
+}
+
 Color oppositeColor(const Color &color)
 {
     if (color == Color::White)
@@ -128,6 +194,53 @@ Board::Board() : state(), squares(), history()
     {
         squares[48 + file] = Piece{PieceType::Pawn, Color::Black};
     }
+
+    state.hash = computeHash();
+}
+
+uint64_t Board::computeHash() const
+{
+    uint64_t key = 0;
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = squares[static_cast<size_t>(sq)];
+        if (p.type != PieceType::None)
+        {
+            key ^= pieceKey(p, sq);
+        }
+    }
+
+    key ^= castlingKey(state.castling);
+
+    if (state.enPassantSquare != -1)
+    {
+        key ^= zobrist.enPassantFile[state.enPassantSquare % 8];
+    }
+
+    if (state.sideToMove == Color::Black)
+    {
+        key ^= zobrist.sideToMove;
+    }
+
+    return key;
+}
+
+void Board::setPiece(int sq, Piece p)
+{
+    size_t s = static_cast<size_t>(sq);
+
+    if (squares[s].type != PieceType::None)
+    {
+        state.hash ^= pieceKey(squares[s], sq);
+    }
+
+    squares[s] = p;
+
+    if (p.type != PieceType::None)
+    {
+        state.hash ^= pieceKey(p, sq);
+    }
 }
 
 std::string Board::print() const
@@ -180,143 +293,250 @@ std::string Board::print() const
     return outputString;
 }
 
-void Board::setFEN(std::string fen)
+const char *toString(FenError error)
 {
-    for (size_t s = 0; s < 64; s++)
+    switch (error)
     {
-        squares[s] = Piece{PieceType::None, Color::None};
+    case FenError::None:
+        return "no error";
+    case FenError::PiecePlacement:
+        return "bad piece placement";
+    case FenError::Kings:
+        return "each side needs exactly one king";
+    case FenError::SideToMove:
+        return "bad side to move";
+    case FenError::Castling:
+        return "bad castling rights";
+    case FenError::EnPassant:
+        return "bad en passant square";
+    case FenError::HalfMoveClock:
+        return "bad half-move clock";
+    case FenError::FullMoveNumber:
+        return "bad full-move number";
+    case FenError::TrailingData:
+        return "unexpected data after the full-move number";
     }
+    return "unknown error";
+}
 
-    // split string into component parts
-    std::istringstream iss(fen);
-    std::string piecePlacement, activeColor, castlingAllowed, enPassantTarget, halfMoveClock, fullMoveNumber;
+// Splits off the next space-separated field, empty at the end of the input
+static std::string_view nextField(std::string_view &text)
+{
+    size_t start = text.find_first_not_of(' ');
+    if (start == std::string_view::npos)
+    {
+        text = std::string_view();
+        return text;
+    }
+    text.remove_prefix(start);
+    size_t end = std::min(text.find(' '), text.size());
+    std::string_view field = text.substr(0, end);
+    text.remove_prefix(end);
+    return field;
+}
 
-    iss >> piecePlacement >> activeColor >> castlingAllowed >> enPassantTarget >> halfMoveClock >> fullMoveNumber;
+static bool parseNumber(std::string_view field, int &value)
+{
+    const char *last = field.data() + field.size();
+    auto [ptr, ec] = std::from_chars(field.data(), last, value);
+    return ec == std::errc() && ptr == last && value >= 0;
+}
 
-    // start from top left
-    size_t current_square = 56;
-    for (char c : piecePlacement)
+static Piece pieceFromChar(char c)
+{
+    Color color = (c >= 'a') ? Color::Black : Color::White;
+    switch (c | 0x20)
     {
-        switch (c)
-        {
-        case ('r'):
-            squares[current_square] = Piece{PieceType::Rook, Color::Black};
-            current_square++;
-            break;
-        case ('n'):
-            squares[current_square] = Piece{PieceType::Knight, Color::Black};
-            current_square++;
-            break;
-        case ('b'):
-            squares[current_square] = Piece{PieceType::Bishop, Color::Black};
-            current_square++;
-            break;
-        case ('q'):
-            squares[current_square] = Piece{PieceType::Queen, Color::Black};
-            current_square++;
-            break;
-        case ('k'):
-            squares[current_square] = Piece{PieceType::King, Color::Black};
-            current_square++;
-            break;
-        case ('p'):
-            squares[current_square] = Piece{PieceType::Pawn, Color::Black};
-            current_square++;
-            break;
-        case ('R'):
-            squares[current_square] = Piece{PieceType::Rook, Color::White};
-            current_square++;
-            break;
-        case ('N'):
-            squares[current_square] = Piece{PieceType::Knight, Color::White};
-            current_square++;
-            break;
-        case ('B'):
-            squares[current_square] = Piece{PieceType::Bishop, Color::White};
-            current_square++;
-            break;
-        case ('Q'):
-            squares[current_square] = Piece{PieceType::Queen, Color::White};
-            current_square++;
-            break;
-        case ('K'):
-            squares[current_square] = Piece{PieceType::King, Color::White};
-            current_square++;
-            break;
-        case ('P'):
-            squares[current_square] = Piece{PieceType::Pawn, Color::White};
-            current_square++;
-            break;
-        case ('/'):
-            current_square -= 16;
-            break;
-        case ('1'):
-            current_square += 1;
-            break;
-        case ('2'):
-            current_square += 2;
-            break;
-        case ('3'):
-            current_square += 3;
-            break;
-        case ('4'):
-            current_square += 4;
-            break;
-        case ('5'):
-            current_square += 5;
-            break;
-        case ('6'):
-            current_square += 6;
-            break;
-        case ('7'):
-            current_square += 7;
-            break;
-        case ('8'):
-            current_square += 8;
-            break;
-        }
+    case 'p':
+        return Piece{PieceType::Pawn, color};
+    case 'n':
+        return Piece{PieceType::Knight, color};
+    case 'b':
+        return Piece{PieceType::Bishop, color};
+    case 'r':
+        return Piece{PieceType::Rook, color};
+    case 'q':
+        return Piece{PieceType::Queen, color};
+    case 'k':
+        return Piece{PieceType::King, color};
+    default:
+        return Piece{PieceType::None, Color::None};
     }
+}
 
-    if (activeColor == "w")
+FenError validatePosition(const BoardArray &pieces, const GameState &state)
+{
+    auto at = [&](int sq, PieceType type, Color color)
     {
-        state.sideToMove = Color::White;
+        Piece p = pieces[static_cast<size_t>(sq)];
+        return p.type == type && p.color == color;
+    };
+
+    int kings[2] = {0, 0};
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = pieces[static_cast<size_t>(sq)];
+        if (p.type == PieceType::Pawn && (sq < 8 || sq >= 56))
+            return FenError::PiecePlacement;
+        if (p.type == PieceType::King)
+            kings[p.color == Color::White ? 0 : 1]++;
     }
-    else
+    if (kings[0] != 1 || kings[1] != 1)
     {
-        state.sideToMove = Color::Black;
+        return FenError::Kings;
     }
 
-    state.castling.whiteKingSide = false;
-    state.castling.whiteQueenSide = false;
-    state.castling.blackKingSide = false;
-    state.castling.blackQueenSide = false;
+    // every right needs its king and rook still on their home squares
+    const CastlingAllowed &rights = state.castling;
+    if ((rights.whiteKingSide || rights.whiteQueenSide) && !at(4, PieceType::King, Color::White))
+        return FenError::Castling;
+    if ((rights.blackKingSide || rights.blackQueenSide) && !at(60, PieceType::King, Color::Black))
+        return FenError::Castling;
+    if ((rights.whiteKingSide && !at(7, PieceType::Rook, Color::White)) || (rights.whiteQueenSide && !at(0, PieceType::Rook, Color::White)) ||
+        (rights.blackKingSide && !at(63, PieceType::Rook, Color::Black)) || (rights.blackQueenSide && !at(56, PieceType::Rook, Color::Black)))
+        return FenError::Castling;
+
+    // the square behind a pawn that just moved two squares: the pawn stands in front of it,
+    // and it and the square the pawn started from are empty
+    if (state.enPassantSquare != -1)
+    {
+        int epRank = (state.sideToMove == Color::White) ? 5 : 2;
+        int epSquare = state.enPassantSquare;
+        if (epSquare < 0 || epSquare >= 64 || epSquare / 8 != epRank)
+            return FenError::EnPassant;
+        int forward = (state.sideToMove == Color::White) ? -8 : 8;
+        if (!at(epSquare + forward, PieceType::Pawn, oppositeColor(state.sideToMove)) || pieces[static_cast<size_t>(epSquare)].type != PieceType::None ||
+            pieces[static_cast<size_t>(epSquare - forward)].type != PieceType::None)
+            return FenError::EnPassant;
+    }
+    return FenError::None;
+}
 
-    for (char c : castlingAllowed)
+FenError Board::parseFEN(std::string_view fen)
+{
+    // parsed into locals first, so a bad FEN leaves the board untouched
+    BoardArray parsed;
+    parsed.fill(Piece{PieceType::None, Color::None});
+    GameState parsedState{};
+
+    std::string_view placement = nextField(fen);
+    int rank = 7;
+    int file = 0;
+    bool afterDigit = false;
+    for (char c : placement)
     {
-        switch (c)
+        if (c == '/')
         {
-        case 'K':
-            state.castling.whiteKingSide = true;
-            break;
-        case 'Q':
-            state.castling.whiteQueenSide = true;
-            break;
-        case 'k':
-            state.castling.blackKingSide = true;
-            break;
-        case 'q':
-            state.castling.blackQueenSide = true;
-            break;
+            if (file != 8 || rank == 0)
+                return FenError::PiecePlacement;
+            rank--;
+            file = 0;
+            afterDigit = false;
+        }
+        else if (c >= '1' && c <= '8')
+        {
+            // a run of empty squares is a single digit, "44" is not "8"
+            file += c - '0';
+            if (file > 8 || afterDigit)
+                return FenError::PiecePlacement;
+            afterDigit = true;
+        }
+        else
+        {
+            afterDigit = false;
+            Piece p = pieceFromChar(c);
+            if (p.type == PieceType::None || file > 7)
+                return FenError::PiecePlacement;
+            parsed[static_cast<size_t>(rank * 8 + file)] = p;
+            file++;
         }
     }
+    if (rank != 0 || file != 8)
+    {
+        return FenError::PiecePlacement;
+    }
 
-    if (enPassantTarget != "-")
+    std::string_view side = nextField(fen);
+    if (side == "w")
+        parsedState.sideToMove = Color::White;
+    else if (side == "b")
+        parsedState.sideToMove = Color::Black;
+    else
+        return FenError::SideToMove;
+
+    std::string_view castling = nextField(fen);
+    if (castling.empty())
+    {
+        return FenError::Castling;
+    }
+    if (castling != "-")
+    {
+        for (char c : castling)
+        {
+            bool *right = (c == 'K') ? &parsedState.castling.whiteKingSide : (c == 'Q') ? &parsedState.castling.whiteQueenSide
+                                                                        : (c == 'k')   ? &parsedState.castling.blackKingSide
+                                                                        : (c == 'q')   ? &parsedState.castling.blackQueenSide
+                                                                                       : nullptr;
+            if (right == nullptr || *right)
+                return FenError::Castling;
+            *right = true;
+        }
+    }
+
+    std::string_view enPassant = nextField(fen);
+    parsedState.enPassantSquare = -1;
+    if (enPassant != "-")
+    {
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] < '1' || enPassant[1] > '8')
+            return FenError::EnPassant;
+        parsedState.enPassantSquare = (enPassant[1] - '1') * 8 + (enPassant[0] - 'a');
+    }
+
+    // EPD-style input stops after the en passant square
+    parsedState.halfMoveClock = 0;
+    parsedState.fullMoveNumber = 1;
+    std::string_view halfMove = nextField(fen);
+    if (!halfMove.empty() && !parseNumber(halfMove, parsedState.halfMoveClock))
+    {
+        return FenError::HalfMoveClock;
+    }
+    std::string_view fullMove = nextField(fen);
+    if (!fullMove.empty() && !parseNumber(fullMove, parsedState.fullMoveNumber))
+    {
+        return FenError::FullMoveNumber;
+    }
+    if (!nextField(fen).empty())
     {
-        state.enPassantSquare = coordsToIndex(enPassantTarget);
+        return FenError::TrailingData;
     }
 
-    state.halfMoveClock = std::stoi(halfMoveClock);
-    state.fullMoveNumber = std::stoi(fullMoveNumber);
+    FenError error = validatePosition(parsed, parsedState);
+    if (error != FenError::None)
+    {
+        return error;
+    }
+    setPosition(parsed, parsedState);
+    return FenError::None;
+}
+
+void Board::setPosition(const BoardArray &pieces, const GameState &gameState)
+{
+    // the history keeps its capacity, so reloading a board does not allocate
+    history.stateHistory.clear();
+    history.arrayHistory.clear();
+    history.keyHistory.clear();
+    squares = pieces;
+    state = gameState;
+    state.hash = computeHash();
+}
+
+void Board::setFEN(std::string_view fen)
+{
+    FenError error = parseFEN(fen);
+    if (error != FenError::None)
+    {
+        throw std::invalid_argument("Invalid FEN (" + std::string(::toString(error)) + "): " + std::string(fen));
+    }
 }
 
 Piece Board::pieceAt(int sq) const
@@ -799,19 +1019,57 @@ bool Board::kingInCheck() const
     return false;
 }
 
+static void revokeCastling(CastlingAllowed &castling, int sq)
+{
+    switch (sq)
+    {
+    case 0:
+        castling.whiteQueenSide = false;
+        break;
+    case 4:
+        castling.whiteKingSide = false;
+        castling.whiteQueenSide = false;
+        break;
+    case 7:
+        castling.whiteKingSide = false;
+        break;
+    case 56:
+        castling.blackQueenSide = false;
+        break;
+    case 60:
+        castling.blackKingSide = false;
+        castling.blackQueenSide = false;
+        break;
+    case 63:
+        castling.blackKingSide = false;
+        break;
+    }
+}
+
 void Board::makeMove(Move move)
 {
     history.stateHistory.push_back(state);
     history.arrayHistory.push_back(squares);
+    history.keyHistory.push_back(state.hash);
     Color movingColor = squares[static_cast<size_t>(move.from)].color;
+    Piece movingPiece = squares[static_cast<size_t>(move.from)];
+    const Piece empty = Piece{PieceType::None, Color::None};
 
-    if (!(squares[static_cast<size_t>(move.from)].type == PieceType::Pawn))
+    // pawn moves and captures are irreversible and reset the fifty-move clock
+    if (movingPiece.type == PieceType::Pawn || squares[static_cast<size_t>(move.to)].type != PieceType::None)
     {
-        state.halfMoveClock += 1;
+        state.halfMoveClock = 0;
     }
     else
     {
-        state.halfMoveClock = 0;
+        state.halfMoveClock += 1;
+    }
+
+    // castling rights and en passant are re-applied to the hash after the move
+    state.hash ^= castlingKey(state.castling);
+    if (state.enPassantSquare != -1)
+    {
+        state.hash ^= zobrist.enPassantFile[state.enPassantSquare % 8];
     }
 
     //clear en passant
@@ -820,16 +1078,16 @@ void Board::makeMove(Move move)
     switch (move.type)
     {
     case (MoveType::Standard):
-        squares[static_cast<size_t>(move.to)] = squares[static_cast<size_t>(move.from)];
-        squares[static_cast<size_t>(move.from)] = Piece{PieceType::None, Color::None};
+        setPiece(move.from, empty);
+        setPiece(move.to, movingPiece);
         break;
     case (MoveType::Capture):
-        squares[static_cast<size_t>(move.to)] = squares[static_cast<size_t>(move.from)];
-        squares[static_cast<size_t>(move.from)] = Piece{PieceType::None, Color::None};
+        setPiece(move.from, empty);
+        setPiece(move.to, movingPiece);
         break;
     case (MoveType::DoublePawnPush):
-        squares[static_cast<size_t>(move.to)] = squares[static_cast<size_t>(move.from)];
-        squares[static_cast<size_t>(move.from)] = Piece{PieceType::None, Color::None};
+        setPiece(move.from, empty);
+        setPiece(move.to, movingPiece);
         if (movingColor == Color::White)
         {
             state.enPassantSquare = move.to - 8;
@@ -840,33 +1098,33 @@ void Board::makeMove(Move move)
         }
         break;
     case (MoveType::EnPassant):
-        squares[static_cast<size_t>(move.to)] = squares[static_cast<size_t>(move.from)];
-        squares[static_cast<size_t>(move.from)] = Piece{PieceType::None, Color::None};
+        setPiece(move.from, empty);
+        setPiece(move.to, movingPiece);
         if (movingColor == Color::White)
         {
-            squares[static_cast<size_t>(move.to - 8)] = Piece{PieceType::None, Color::None};
+            setPiece(move.to - 8, empty);
         }
         else
         {
-            squares[static_cast<size_t>(move.to + 8)] = Piece{PieceType::None, Color::None};
+            setPiece(move.to + 8, empty);
         }
         break;
     case (MoveType::KingCastle):
         if (movingColor == Color::White)
         {
-            squares[4] = Piece{PieceType::None, Color::None};
-            squares[5] = Piece{PieceType::Rook, Color::White};
-            squares[6] = Piece{PieceType::King, Color::White};
-            squares[7] = Piece{PieceType::None, Color::None};
+            setPiece(4, empty);
+            setPiece(5, Piece{PieceType::Rook, Color::White});
+            setPiece(6, Piece{PieceType::King, Color::White});
+            setPiece(7, empty);
             state.castling.whiteKingSide = false;
             state.castling.whiteQueenSide = false;
         }
         else
         {
-            squares[60] = Piece{PieceType::None, Color::None};
-            squares[61] = Piece{PieceType::Rook, Color::Black};
-            squares[62] = Piece{PieceType::King, Color::Black};
-            squares[63] = Piece{PieceType::None, Color::None};
+            setPiece(60, empty);
+            setPiece(61, Piece{PieceType::Rook, Color::Black});
+            setPiece(62, Piece{PieceType::King, Color::Black});
+            setPiece(63, empty);
             state.castling.blackKingSide = false;
             state.castling.blackQueenSide = false;
         }
@@ -874,28 +1132,39 @@ void Board::makeMove(Move move)
     case (MoveType::QueenCastle):
         if (movingColor == Color::White)
         {
-            squares[0] = Piece{PieceType::None, Color::None};
-            squares[2] = Piece{PieceType::King, Color::White};
-            squares[3] = Piece{PieceType::Rook, Color::White};
-            squares[4] = Piece{PieceType::None, Color::None};
+            setPiece(0, empty);
+            setPiece(2, Piece{PieceType::King, Color::White});
+            setPiece(3, Piece{PieceType::Rook, Color::White});
+            setPiece(4, empty);
             state.castling.whiteKingSide = false;
             state.castling.whiteQueenSide = false;
         }
         else
         {
-            squares[56] = Piece{PieceType::None, Color::None};
-            squares[58] = Piece{PieceType::King, Color::Black};
-            squares[59] = Piece{PieceType::Rook, Color::Black};
-            squares[60] = Piece{PieceType::None, Color::None};
+            setPiece(56, empty);
+            setPiece(58, Piece{PieceType::King, Color::Black});
+            setPiece(59, Piece{PieceType::Rook, Color::Black});
+            setPiece(60, empty);
             state.castling.blackKingSide = false;
             state.castling.blackQueenSide = false;
         }
         break;
     case (MoveType::Promotion):
-        squares[static_cast<size_t>(move.to)] = Piece{move.promotion, movingColor};
-        squares[static_cast<size_t>(move.from)] = Piece{PieceType::None, Color::None};
+        setPiece(move.from, empty);
+        setPiece(move.to, Piece{move.promotion, movingColor});
         break;
     }
+
+    // a king or rook leaving its home square, or a rook taken on it, ends those rights
+    revokeCastling(state.castling, move.from);
+    revokeCastling(state.castling, move.to);
+
+    state.hash ^= castlingKey(state.castling);
+    if (state.enPassantSquare != -1)
+    {
+        state.hash ^= zobrist.enPassantFile[state.enPassantSquare % 8];
+    }
+    state.hash ^= zobrist.sideToMove;
     
     if (state.sideToMove == Color::White)
     {
@@ -914,6 +1183,15 @@ void Board::unMakeMove()
     squares = history.arrayHistory.back();
     history.stateHistory.pop_back();
     history.arrayHistory.pop_back();
+    history.keyHistory.pop_back();
+}
+
+void Board::reserveHistory(size_t plies)
+{
+    size_t needed = history.stateHistory.size() + plies;
+    history.stateHistory.reserve(needed);
+    history.arrayHistory.reserve(needed);
+    history.keyHistory.reserve(needed);
 }
 
 std::string Board::indexToCoords(int sq)
@@ -944,83 +1222,130 @@ std::string Board::indexToCoords(int sq)
     }
 }
 
-std::string Board::getFEN()
+size_t Board::writeFEN(char *buffer, size_t size) const
 {
-    std::string outputString;
-    int emptyCount;
+    char fen[fenBufferSize];
+    char *out = fen;
+
     for (int rank = 7; rank >= 0; rank--)
     {
+        int emptyCount = 0;
         for (int file = 0; file < 8; file++)
         {
             Piece p = pieceAt(rank * 8 + file);
-            if (p.type != PieceType::None)
+            if (p.type == PieceType::None)
             {
-                if (emptyCount > 0)
-                {
-                    outputString += std::to_string(emptyCount);
-                }
-                outputString += pieceToChar(p);
-                emptyCount = 0;
+                emptyCount++;
+                continue;
             }
-            else
+            if (emptyCount > 0)
             {
-                emptyCount++;
+                *out++ = static_cast<char>('0' + emptyCount);
+                emptyCount = 0;
             }
+            *out++ = pieceToChar(p);
         }
         if (emptyCount > 0)
         {
-            outputString += std::to_string(emptyCount);
+            *out++ = static_cast<char>('0' + emptyCount);
         }
-        emptyCount = 0;
         if (rank > 0)
         {
-            outputString += "/";
+            *out++ = '/';
         }
     }
-    if (state.sideToMove == Color::White)
-    {
-        outputString += " w ";
-    }
-    else
-    {
-        outputString += " b ";
-    }
+
+    *out++ = ' ';
+    *out++ = (state.sideToMove == Color::White) ? 'w' : 'b';
+    *out++ = ' ';
+
+    char *castlingStart = out;
     if (state.castling.whiteKingSide)
-    {
-        outputString += "K";
-    }
+        *out++ = 'K';
     if (state.castling.whiteQueenSide)
-    {
-        outputString += "Q";
-    }
+        *out++ = 'Q';
     if (state.castling.blackKingSide)
-    {
-        outputString += "k";
-    }
+        *out++ = 'k';
     if (state.castling.blackQueenSide)
+        *out++ = 'q';
+    if (out == castlingStart)
+        *out++ = '-';
+    *out++ = ' ';
+
+    if (state.enPassantSquare != -1)
     {
-        outputString += "q";
+        *out++ = static_cast<char>('a' + state.enPassantSquare % 8);
+        *out++ = static_cast<char>('1' + state.enPassantSquare / 8);
     }
-    if (!state.castling.whiteKingSide && !state.castling.whiteQueenSide && !state.castling.blackKingSide && !state.castling.blackQueenSide)
+    else
     {
-        outputString += "-";
+        *out++ = '-';
     }
-    if (state.enPassantSquare != -1)
+
+    // an int takes at most 11 characters
+    *out++ = ' ';
+    out = std::to_chars(out, out + 11, state.halfMoveClock).ptr;
+    *out++ = ' ';
+    out = std::to_chars(out, out + 11, state.fullMoveNumber).ptr;
+
+    size_t length = static_cast<size_t>(out - fen);
+    if (length + 1 > size)
     {
-        outputString += " " + indexToCoords(state.enPassantSquare) + " ";
+        return 0;
     }
-    else
+    std::copy(fen, out, buffer);
+    buffer[length] = '\0';
+    return length;
+}
+
+std::string Board::getFEN() const
+{
+    char fen[fenBufferSize];
+    size_t length = writeFEN(fen, sizeof(fen));
+    return std::string(fen, length);
+}
+
+int Board::halfMoveCounter() const
+{
+    return state.halfMoveClock;
+}
+
+int Board::fullMoveNumber() const
+{
+    return state.fullMoveNumber;
+}
+
+// Counts earlier occurrences of the current position. Only positions since the
+// last irreversible move can repeat, and only those with the same side to move.
+int Board::repetitionCount() const
+{
+    int count = 0;
+    int size = static_cast<int>(history.keyHistory.size());
+    int oldest = std::max(0, size - state.halfMoveClock);
+
+    for (int i = size - 2; i >= oldest; i -= 2)
     {
-        outputString += " - ";
+        if (history.keyHistory[static_cast<size_t>(i)] == state.hash)
+        {
+            count++;
+        }
     }
-    outputString += std::to_string(state.halfMoveClock) + " ";
-    outputString += std::to_string(state.fullMoveNumber);
-    return outputString;
+    return count;
 }
 
-int Board::halfMoveCounter()
+bool Board::isRepetition() const
 {
-    return state.halfMoveClock;
+    return repetitionCount() >= 1;
+}
+
+bool Board::isThreefoldRepetition() const
+{
+    return repetitionCount() >= 2;
+}
+
+bool Board::isFiftyMoveDraw() const
+{
+    return state.halfMoveClock >= 100;
 }
 
 std::string toString(Color color)
@@ -1028,7 +1353,18 @@ std::string toString(Color color)
     return (color == Color::White) ? "white" : "black";
 }
 
+// Coordinate notation, as UCI uses it
 std::string Board::toString(Move move)
 {
-    return pieceToChar(pieceAt(move.from)) + indexToCoords(move.from) + indexToCoords(move.to);
+    std::string text = indexToCoords(move.from) + indexToCoords(move.to);
+    if (move.promotion != PieceType::None)
+    {
+        text += static_cast<char>(pieceToChar(Piece{move.promotion, Color::Black}));
+    }
+    return text;
 }
+
+uint64_t Board::hash() const
+{
+    return state.hash;
+}
\ No newline at end of file
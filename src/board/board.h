@@ -3,6 +3,8 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <string_view>
+#include <cstdint>
 
 enum struct Color
 {
@@ -13,6 +15,24 @@ enum struct Color
 
 std::string toString(Color color);
 
+enum struct FenError
+{
+    None,
+    PiecePlacement,
+    Kings,
+    SideToMove,
+    Castling,
+    EnPassant,
+    HalfMoveClock,
+    FullMoveNumber,
+    TrailingData
+};
+
+const char *toString(FenError error);
+
+// Longest FEN writeFEN can produce, with its terminating NUL
+const size_t fenBufferSize = 128;
+
 
 enum struct PieceType
 {
@@ -46,6 +66,7 @@ struct GameState
     int enPassantSquare;
     int halfMoveClock;
     int fullMoveNumber;
+    uint64_t hash;
 };
 
 enum struct MoveType
@@ -67,6 +88,10 @@ struct Move
     PieceType promotion = PieceType::None;
 };
 
+bool operator==(const Move &a, const Move &b);
+
+bool operator!=(const Move &a, const Move &b);
+
 struct ScoredMove
 {
     Move move;
@@ -77,11 +102,17 @@ using BoardArray = std::array<Piece, 64>;
 using MoveList = std::vector<Move>;
 using ScoredMoveList = std::vector<ScoredMove>;
 
+// The checks parseFEN makes beyond syntax, for positions built any other way: pawns off
+// the back ranks, one king a side, castling rights with king and rook at home, and an
+// en passant square a pawn of the side that just moved could have pushed past
+FenError validatePosition(const BoardArray &pieces, const GameState &state);
+
 struct UndoHistory
 {
     std::vector<GameState> stateHistory;
     std::vector<BoardArray> arrayHistory;
-    UndoHistory() : stateHistory(), arrayHistory() {}
+    std::vector<uint64_t> keyHistory; // hash of every earlier position, scanned for repetitions
+    UndoHistory() : stateHistory(), arrayHistory(), keyHistory() {}
 };
 
 Color oppositeColor(const Color &color);
@@ -95,12 +126,24 @@ private:
 
     char pieceToChar(const Piece p) const;
 
+    void setPiece(int sq, Piece p);
+
+    uint64_t computeHash() const;
+
 public:
     Board();
 
     std::string print() const;
 
-    void setFEN(std::string fen);
+    // Strict parse that neither allocates nor throws; on error the board is unchanged.
+    // The position must pass validatePosition. The clocks may be left out, as in EPD.
+    FenError parseFEN(std::string_view fen);
+
+    // parseFEN that throws std::invalid_argument on error
+    void setFEN(std::string_view fen);
+
+    // Replaces the position and clears the history; the hash in gameState is recomputed
+    void setPosition(const BoardArray &pieces, const GameState &gameState);
 
     Piece pieceAt(int sq) const;
 
@@ -128,11 +171,29 @@ public:
 
     void unMakeMove();
 
+    // Makes room for this many more moves, so searching them never reallocates the undo stack
+    void reserveHistory(size_t plies);
+
     std::string indexToCoords(int sq);
 
-    std::string getFEN();
+    // Writes the NUL-terminated FEN into buffer and returns its length, or 0 if it does not fit
+    size_t writeFEN(char *buffer, size_t size) const;
+
+    std::string getFEN() const;
+
+    int halfMoveCounter() const;
 
-    int halfMoveCounter();
+    int fullMoveNumber() const;
+
+    int repetitionCount() const;
+
+    bool isRepetition() const;
+
+    bool isThreefoldRepetition() const;
+
+    bool isFiftyMoveDraw() const;
 
     std::string toString(Move move);
+
+    uint64_t hash() const;
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "board/board.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+const int polyglotKeyCount = 781;
+const size_t polyglotEntrySize = 16;
+
+enum struct BookSelection
+{
+    Best,    // highest weight
+    Weighted // random, in proportion to weight
+};
+
+struct BookEntry
+{
+    Move move;
+    int weight = 0;
+};
+
+uint64_t polyglotKey(const Board &board);
+
+// Read-only Polyglot book. The file is memory-mapped and binary-searched in place,
+// so opening it parses nothing and a probe only touches the pages it lands on.
+class OpeningBook
+{
+private:
+    const unsigned char *data;
+    size_t mappedSize;
+    size_t entryCount;
+
+    uint64_t keyAt(size_t index) const;
+
+public:
+    OpeningBook();
+
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook &) = delete;
+
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    void open(const std::string &path);
+
+    void close();
+
+    bool isOpen() const;
+
+    size_t size() const;
+
+    // Legal book moves for the position, in file order
+    std::vector<BookEntry> entries(Board &board) const;
+
+    bool probe(Board &board, Move &move, BookSelection selection, std::mt19937_64 &rng) const;
+};
\ No newline at end of file
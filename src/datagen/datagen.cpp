@@ -0,0 +1,176 @@
+#include "datagen.h"
+#include "evaluate/evaluate.h"
+#include "generate/generate.h"
+#include "packed/packed.h"
+#include "timeman/timeman.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const char *const startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Random legal moves from the start position; false if the game ended on the way
+static bool randomOpening(Board &board, int plies, std::mt19937_64 &rng)
+{
+    board.setFEN(startFEN);
+    for (int ply = 0; ply < plies; ply++)
+    {
+        MoveList moves = generateLegalMoves(board);
+        if (moves.empty())
+        {
+            return false;
+        }
+        board.makeMove(moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)]);
+    }
+    return gameStatus(board) == GameStatus::Ongoing;
+}
+
+static bool isQuiet(const Board &board, const Move &move)
+{
+    return board.pieceAt(move.to).type == PieceType::None && move.type != MoveType::EnPassant && move.promotion == PieceType::None;
+}
+
+// One game; the samples get the result once it is known. Returns white's result.
+static int playGame(const DatagenSettings &settings, TranspositionTable &table, std::mt19937_64 &rng, std::vector<PackedPosition> &samples)
+{
+    samples.clear();
+
+    Board board;
+    while (!randomOpening(board, settings.randomPlies, rng))
+    {
+    }
+    table.clear();
+
+    SearchOptions options;
+    options.table = &table;
+    SearchLimits limits;
+    limits.nodes = settings.nodes;
+
+    int result = 0;
+    int winningPlies = 0;
+    int losingPlies = 0;
+
+    for (int ply = 0; ply < settings.maxPlies; ply++)
+    {
+        GameStatus status = gameStatus(board);
+        if (status == GameStatus::Checkmate)
+        {
+            result = (board.sideToMove() == Color::White) ? -1 : 1;
+            break;
+        }
+        if (status != GameStatus::Ongoing)
+        {
+            break;
+        }
+
+        TimeManager timeManager;
+        timeManager.start(limits, board.sideToMove());
+        SearchResult search = searchPosition(board, maxSearchPly - 1, timeManager, nullptr, options);
+        int whiteScore = (board.sideToMove() == Color::White) ? search.score : -search.score;
+
+        // a single legal move is played without a search, its score of 0 means nothing
+        bool scored = search.depth > 0 && generateLegalMoves(board).size() > 1;
+        if (scored && !board.kingInCheck() && isQuiet(board, search.bestMove) && std::abs(search.score) < TB_WIN_BOUND)
+        {
+            PackedPosition packed = packPosition(board);
+            packed.score = static_cast<int16_t>(std::clamp(whiteScore, -32000, 32000));
+            samples.push_back(packed);
+        }
+
+        // both sides agreeing on a decisive score ends the game early
+        if (scored)
+        {
+            winningPlies = (whiteScore >= settings.adjudicateScore) ? winningPlies + 1 : 0;
+            losingPlies = (whiteScore <= -settings.adjudicateScore) ? losingPlies + 1 : 0;
+        }
+        if (winningPlies >= settings.adjudicatePlies || losingPlies >= settings.adjudicatePlies)
+        {
+            result = (winningPlies > 0) ? 1 : -1;
+            break;
+        }
+
+        board.makeMove(search.bestMove);
+    }
+
+    for (PackedPosition &packed : samples)
+    {
+        packed.result = static_cast<int8_t>(result);
+    }
+    return result;
+}
+
+// Every thread plays whole games and appends their samples under one lock,
+// so a game's positions stay together in the file
+DatagenResult generateTrainingData(const DatagenSettings &settings)
+{
+    PackedWriter writer(settings.output, settings.append);
+    std::mutex writerMutex;
+    std::atomic<uint64_t> written(0);
+    std::atomic<uint64_t> games(0);
+    uint64_t seed = (settings.seed != 0) ? settings.seed : std::random_device()();
+    auto start = std::chrono::steady_clock::now();
+
+    auto elapsed = [&start]()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, settings.threads); t++)
+    {
+        pool.emplace_back([&, t]()
+                          {
+            std::mt19937_64 rng(seed + static_cast<uint64_t>(t) * 0x9E3779B97F4A7C15ULL);
+            TranspositionTable table(settings.hashMB);
+            std::vector<PackedPosition> samples;
+
+            while (written < settings.positions)
+            {
+                try
+                {
+                    playGame(settings, table, rng, samples);
+                }
+                catch (const std::exception &e)
+                {
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    std::cout << "Game skipped: " << e.what() << std::endl;
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(writerMutex);
+                size_t room = static_cast<size_t>(settings.positions - std::min<uint64_t>(written, settings.positions));
+                size_t count = std::min(samples.size(), room);
+                for (size_t i = 0; i < count; i++)
+                {
+                    writer.write(samples[i]);
+                }
+                written += count;
+                uint64_t played = ++games;
+
+                if (played % 100 == 0)
+                {
+                    double seconds = elapsed();
+                    std::cout << "Games " << played << ", positions " << written << " (" << static_cast<uint64_t>(written / std::max(seconds, 1e-9) * 3600)
+                              << " per hour)" << std::endl;
+                }
+            } });
+    }
+
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+    writer.flush();
+
+    DatagenResult result;
+    result.games = games;
+    result.positions = written;
+    result.seconds = elapsed();
+    std::cout << result.games << " games, " << result.positions << " positions written to " << settings.output << " in " << result.seconds << " s" << std::endl;
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct DatagenSettings
+{
+    std::string output = "data.bin";
+    bool append = false;          // add to an existing output instead of replacing it
+    uint64_t positions = 1000000; // stops once this many samples are written
+    int threads = 1;
+    uint64_t nodes = 5000;      // per move
+    int randomPlies = 8;        // random legal moves before the engine takes over
+    int maxPlies = 400;         // a draw beyond this
+    int adjudicateScore = 2000; // a side this far ahead for adjudicatePlies plies wins
+    int adjudicatePlies = 8;
+    size_t hashMB = 16; // per thread
+    uint64_t seed = 0;  // 0 picks a random seed
+};
+
+struct DatagenResult
+{
+    uint64_t games = 0;
+    uint64_t positions = 0;
+    double seconds = 0;
+};
+
+// Plays fixed-node self-play games and writes (position, score, result) samples to
+// settings.output as PackedPosition records, replacing the file unless settings.append:
+// score is the search score and result the game result (1, 0, -1), both from white's view. Positions in check, with a single legal
+// move or no completed iteration, with a capture or promotion as the best move, or with a
+// mate or tablebase score are left out.
+DatagenResult generateTrainingData(const DatagenSettings &settings);
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "endgame.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <vector>
+
+// KPK index: strong king, weak king, side to move, pawn file (a-d) and pawn rank (2-7)
+const int kpkIndexCount = 2 * 24 * 64 * 64;
+
+// KPK results are bit flags so the results of all moves can be or-ed together
+const uint8_t kpkInvalid = 0;
+const uint8_t kpkUnknown = 1;
+const uint8_t kpkDraw = 2;
+const uint8_t kpkWin = 4;
+
+static int fileOf(int sq)
+{
+    return sq & 7;
+}
+
+static int rankOf(int sq)
+{
+    return sq >> 3;
+}
+
+static int distance(int a, int b)
+{
+    return std::max(std::abs(fileOf(a) - fileOf(b)), std::abs(rankOf(a) - rankOf(b)));
+}
+
+static int kpkIndex(bool strongToMove, int weakKing, int strongKing, int pawn)
+{
+    return strongKing | (weakKing << 6) | ((strongToMove ? 0 : 1) << 12) | (fileOf(pawn) << 13) | ((6 - rankOf(pawn)) << 15);
+}
+
+static bool pawnAttacks(int pawn, int sq)
+{
+    return rankOf(sq) == rankOf(pawn) + 1 && std::abs(fileOf(sq) - fileOf(pawn)) == 1;
+}
+
+static std::vector<int> computeKingSteps(int sq)
+{
+    std::vector<int> steps;
+    for (int df = -1; df <= 1; df++)
+    {
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            int file = fileOf(sq) + df;
+            int rank = rankOf(sq) + dr;
+            if ((df != 0 || dr != 0) && file >= 0 && file < 8 && rank >= 0 && rank < 8)
+                steps.push_back(rank * 8 + file);
+        }
+    }
+    return steps;
+}
+
+static const std::vector<int> &kingSteps(int sq)
+{
+    static const std::vector<std::vector<int>> steps = []
+    {
+        std::vector<std::vector<int>> all;
+        for (int from = 0; from < 64; from++)
+            all.push_back(computeKingSteps(from));
+        return all;
+    }();
+    return steps[static_cast<size_t>(sq)];
+}
+
+struct KPKPosition
+{
+    int strongKing;
+    int weakKing;
+    int pawn;
+    bool strongToMove;
+    uint8_t result;
+
+    explicit KPKPosition(int idx)
+    {
+        strongKing = idx & 0x3F;
+        weakKing = (idx >> 6) & 0x3F;
+        strongToMove = ((idx >> 12) & 1) == 0;
+        pawn = (6 - ((idx >> 15) & 7)) * 8 + ((idx >> 13) & 3);
+
+        int promotion = pawn + 8;
+        const std::vector<int> &weakSteps = kingSteps(weakKing);
+        auto weakCanGoTo = [&](int sq)
+        {
+            return distance(sq, strongKing) > 1 && !pawnAttacks(pawn, sq);
+        };
+
+        if (distance(strongKing, weakKing) <= 1 || strongKing == pawn || weakKing == pawn ||
+            (strongToMove && pawnAttacks(pawn, weakKing)))
+        {
+            result = kpkInvalid;
+        }
+        // the pawn promotes and the new queen cannot be taken
+        else if (strongToMove && rankOf(pawn) == 6 && strongKing != promotion &&
+                 (distance(weakKing, promotion) > 1 || distance(strongKing, promotion) == 1))
+        {
+            result = kpkWin;
+        }
+        // stalemate, or the pawn falls
+        else if (!strongToMove && (std::none_of(weakSteps.begin(), weakSteps.end(), weakCanGoTo) ||
+                                   (distance(weakKing, pawn) == 1 && distance(strongKing, pawn) > 1)))
+        {
+            result = kpkDraw;
+        }
+        else
+        {
+            result = kpkUnknown;
+        }
+    }
+
+    // A side to move wins (or holds) if any move does; it loses if every move loses
+    uint8_t classify(const std::vector<KPKPosition> &db)
+    {
+        uint8_t good = strongToMove ? kpkWin : kpkDraw;
+        uint8_t bad = strongToMove ? kpkDraw : kpkWin;
+        uint8_t r = kpkInvalid;
+
+        for (int to : kingSteps(strongToMove ? strongKing : weakKing))
+        {
+            r |= strongToMove ? db[kpkIndex(false, weakKing, to, pawn)].result : db[kpkIndex(true, to, strongKing, pawn)].result;
+        }
+
+        if (strongToMove)
+        {
+            if (rankOf(pawn) < 6)
+                r |= db[kpkIndex(false, weakKing, strongKing, pawn + 8)].result;
+            if (rankOf(pawn) == 1 && pawn + 8 != strongKing && pawn + 8 != weakKing)
+                r |= db[kpkIndex(false, weakKing, strongKing, pawn + 16)].result;
+        }
+
+        result = (r & good) ? good : (r & kpkUnknown) ? kpkUnknown : bad;
+        return result;
+    }
+};
+
+// Win flags of the KPK bitbase, filled in by initKPK
+static std::bitset<kpkIndexCount> kpkWins;
+
+void initKPK()
+{
+    std::vector<KPKPosition> db;
+    db.reserve(kpkIndexCount);
+    for (int idx = 0; idx < kpkIndexCount; idx++)
+    {
+        db.emplace_back(idx);
+    }
+
+    // Retrograde passes until nothing changes; what is still unknown is a draw
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (KPKPosition &position : db)
+        {
+            if (position.result == kpkUnknown && position.classify(db) != kpkUnknown)
+                changed = true;
+        }
+    }
+
+    for (int idx = 0; idx < kpkIndexCount; idx++)
+    {
+        kpkWins[static_cast<size_t>(idx)] = db[static_cast<size_t>(idx)].result == kpkWin;
+    }
+}
+
+bool probeKPK(int strongKing, int strongPawn, int weakKing, bool strongToMove)
+{
+    return kpkWins[static_cast<size_t>(kpkIndex(strongToMove, weakKing, strongKing, strongPawn))];
+}
+
+// Larger the closer the square is to the board edge, 0 in the centre
+static int edgeBonus(int sq)
+{
+    int file = std::min(fileOf(sq), 7 - fileOf(sq));
+    int rank = std::min(rankOf(sq), 7 - rankOf(sq));
+    return 20 * (3 - std::min(file, rank)) + 10 * (6 - file - rank);
+}
+
+static int closeBonus(int a, int b)
+{
+    return 20 * (7 - distance(a, b));
+}
+
+bool evaluateEndgame(const Board &board, int &score)
+{
+    int counts[2][7] = {};
+    int king[2] = {-1, -1};
+    int lastSquare[2][7] = {};
+    int pieces = 0;
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = board.pieceAt(sq);
+        if (p.type == PieceType::None)
+            continue;
+        int side = (p.color == Color::White) ? 0 : 1;
+        int type = static_cast<int>(p.type);
+        counts[side][type]++;
+        lastSquare[side][type] = sq;
+        if (p.type == PieceType::King)
+            king[side] = sq;
+        else if (++pieces > 2)
+            return false;
+    }
+
+    if (king[0] < 0 || king[1] < 0)
+    {
+        return false;
+    }
+
+    // a lone minor cannot mate
+    int minors = counts[0][2] + counts[0][3] + counts[1][2] + counts[1][3];
+    if (pieces == 0 || (pieces == 1 && minors == 1))
+    {
+        score = 0;
+        return true;
+    }
+
+    // every remaining case is one side with all the material against a bare king
+    int strong = (counts[1][1] + counts[1][2] + counts[1][3] + counts[1][4] + counts[1][5] == 0) ? 0 : 1;
+    int weak = 1 - strong;
+    if (counts[weak][1] + counts[weak][2] + counts[weak][3] + counts[weak][4] + counts[weak][5] != 0)
+    {
+        return false;
+    }
+
+    bool strongToMove = (board.sideToMove() == Color::White) == (strong == 0);
+    int strongKing = king[strong];
+    int weakKing = king[weak];
+    int strongScore;
+
+    if (pieces == 1 && counts[strong][1] == 1)
+    {
+        // seen from the pawn side: flip black to white, then mirror the pawn onto files a-d
+        int pawn = lastSquare[strong][1];
+        int flip = (strong == 1) ? 56 : 0;
+        int mirror = (fileOf(pawn) > 3) ? 7 : 0;
+        pawn ^= flip ^ mirror;
+        if (!probeKPK(strongKing ^ flip ^ mirror, pawn, weakKing ^ flip ^ mirror, strongToMove))
+        {
+            score = 0;
+            return true;
+        }
+        strongScore = KNOWN_WIN + 100 + 10 * rankOf(pawn);
+    }
+    else if (pieces == 1 && (counts[strong][4] == 1 || counts[strong][5] == 1))
+    {
+        // drive the bare king to the edge with our own king close behind
+        strongScore = KNOWN_WIN + (counts[strong][5] ? 900 : 500) + edgeBonus(weakKing) + closeBonus(strongKing, weakKing);
+    }
+    else if (pieces == 2 && counts[strong][2] == 1 && counts[strong][3] == 1)
+    {
+        // mate only works in a corner the bishop covers
+        int bishop = lastSquare[strong][3];
+        bool darkBishop = (fileOf(bishop) + rankOf(bishop)) % 2 == 0;
+        int cornerA = darkBishop ? 0 : 7;
+        int cornerB = darkBishop ? 63 : 56;
+        int cornerDistance = std::min(distance(weakKing, cornerA), distance(weakKing, cornerB));
+        strongScore = KNOWN_WIN + 650 + 40 * (7 - cornerDistance) + closeBonus(strongKing, weakKing);
+    }
+    else
+    {
+        return false;
+    }
+
+    score = strongToMove ? strongScore : -strongScore;
+    return true;
+}
\ No newline at end of file
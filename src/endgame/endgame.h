@@ -0,0 +1,17 @@
+#pragma once
+
+#include "board/board.h"
+
+// Score of a position known to be won without tablebases; above any material
+// balance but below the tablebase and mate ranges
+const int KNOWN_WIN = 10000;
+
+// KPK bitbase: squares as seen by the side with the pawn, the pawn on files a-d.
+// True when that side wins. initKPK fills it by retrograde analysis (24 KB) and
+// must run once at startup, before any search.
+void initKPK();
+bool probeKPK(int strongKing, int strongPawn, int weakKing, bool strongToMove);
+
+// Exact or mating-guidance score from the side to move's view for KPK, KRK, KQK,
+// KBNK and the insufficient-material draws. Returns false for any other material.
+bool evaluateEndgame(const Board &board, int &score);
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "epd.h"
+#include "evaluate/evaluate.h"
+#include "notation/notation.h"
+#include "timeman/timeman.h"
+#include "uci/uci.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+static std::string trim(const std::string &text)
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+// An EPD line is the first four FEN fields followed by ';'-terminated operations
+std::vector<EpdPosition> loadEpd(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open EPD file: " + path);
+    }
+
+    std::vector<EpdPosition> positions;
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        std::string placement, side, castling, enPassant;
+        if (!(iss >> placement >> side >> castling >> enPassant))
+        {
+            continue;
+        }
+
+        EpdPosition position;
+        position.fen = placement + " " + side + " " + castling + " " + enPassant + " 0 1";
+
+        std::string operations;
+        std::getline(iss, operations);
+        std::istringstream opStream(operations);
+        std::string operation;
+
+        while (std::getline(opStream, operation, ';'))
+        {
+            std::istringstream fields(trim(operation));
+            std::string opcode, operand;
+            fields >> opcode;
+
+            if (opcode == "bm" || opcode == "am")
+            {
+                std::vector<std::string> &moves = (opcode == "bm") ? position.bestMoves : position.avoidMoves;
+                while (fields >> operand)
+                {
+                    moves.push_back(operand);
+                }
+            }
+            else if (opcode == "id")
+            {
+                std::getline(fields, operand);
+                operand = trim(operand);
+                operand.erase(std::remove(operand.begin(), operand.end(), '"'), operand.end());
+                position.id = operand;
+            }
+        }
+
+        if (position.id.empty())
+        {
+            position.id = "#" + std::to_string(positions.size() + 1);
+        }
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+EpdResult runEpdPosition(const EpdPosition &position, double timeLimit, uint64_t nodeLimit, TranspositionTable &table)
+{
+    Board board;
+    board.setFEN(position.fen);
+
+    MoveList bestMoves, avoidMoves;
+    for (const std::string &san : position.bestMoves)
+    {
+        bestMoves.push_back(sanToMove(board, san));
+    }
+    for (const std::string &san : position.avoidMoves)
+    {
+        avoidMoves.push_back(sanToMove(board, san));
+    }
+
+    auto isCorrect = [&](const Move &m)
+    {
+        if (!bestMoves.empty() && std::find(bestMoves.begin(), bestMoves.end(), m) == bestMoves.end())
+            return false;
+        return std::find(avoidMoves.begin(), avoidMoves.end(), m) == avoidMoves.end();
+    };
+
+    SearchLimits limits;
+    limits.moveTime = (timeLimit > 0) ? static_cast<int>(timeLimit * 1000) : -1;
+    limits.nodes = nodeLimit;
+
+    table.clear();
+    SearchOptions options;
+    options.table = &table;
+
+    TimeManager timeManager;
+    timeManager.start(limits, board.sideToMove());
+
+    EpdResult result;
+    result.id = position.id;
+    bool correct = false;
+
+    // track when the search settled on a correct move for good
+    SearchResult search = searchPosition(board, maxSearchPly - 1, timeManager, [&](const SearchResult &iteration)
+                                         {
+        bool nowCorrect = isCorrect(iteration.bestMove);
+        if (nowCorrect && !correct)
+        {
+            result.solveTime = timeManager.elapsed();
+            result.solveNodes = iteration.nodes;
+        }
+        correct = nowCorrect; }, options);
+
+    result.move = search.bestMove;
+    result.depth = search.depth;
+    result.solved = isCorrect(search.bestMove);
+    if (result.solved && !correct)
+    {
+        // settled in a partial iteration or without completing one
+        result.solveTime = timeManager.elapsed();
+        result.solveNodes = search.nodes;
+    }
+    return result;
+}
+
+// Positions are handed out to a fixed pool of threads. Each thread has its own
+// transposition table, cleared for every position, so solve times and nodes do not
+// depend on scheduling; only the evaluation cache, which never changes a score, is shared.
+std::vector<EpdResult> runEpdSuite(const std::vector<EpdPosition> &positions, double timeLimit, uint64_t nodeLimit, int threads, size_t hashMB)
+{
+    std::vector<EpdResult> results(positions.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+
+    for (int t = 0; t < std::max(1, threads); t++)
+    {
+        pool.emplace_back([&]()
+                          {
+            TranspositionTable table(hashMB);
+            for (size_t i = next++; i < positions.size(); i = next++)
+            {
+                try
+                {
+                    results[i] = runEpdPosition(positions[i], timeLimit, nodeLimit, table);
+                }
+                catch (const std::exception &e)
+                {
+                    results[i].id = positions[i].id + " (" + e.what() + ")";
+                }
+            } });
+    }
+
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+    return results;
+}
+
+void printEpdReport(const std::vector<EpdPosition> &positions, const std::vector<EpdResult> &results)
+{
+    int solved = 0;
+    double totalTime = 0;
+    uint64_t totalNodes = 0;
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const EpdResult &r = results[i];
+        std::cout << std::left << std::setw(16) << r.id << (r.solved ? " solved  " : " failed  ") << std::setw(7) << moveToUci(r.move);
+        std::cout << " depth " << std::setw(3) << r.depth;
+        if (r.solved)
+        {
+            std::cout << " time " << std::fixed << std::setprecision(3) << r.solveTime << "s nodes " << r.solveNodes;
+            solved++;
+            totalTime += r.solveTime;
+            totalNodes += r.solveNodes;
+        }
+        else
+        {
+            std::string expected;
+            for (const std::string &m : positions[i].bestMoves)
+                expected += " bm " + m;
+            for (const std::string &m : positions[i].avoidMoves)
+                expected += " am " + m;
+            std::cout << " expected" << expected;
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "\nSolved " << solved << " / " << results.size();
+    if (solved > 0)
+    {
+        std::cout << std::fixed << std::setprecision(3) << " | average time to solution " << totalTime / solved
+                  << "s | average nodes to solution " << totalNodes / static_cast<uint64_t>(solved);
+    }
+    std::cout << std::endl;
+}
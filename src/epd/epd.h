@@ -0,0 +1,34 @@
+#pragma once
+
+#include "board/board.h"
+#include "tt/tt.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct EpdPosition
+{
+    std::string fen;
+    std::string id;
+    std::vector<std::string> bestMoves;  // "bm", in SAN
+    std::vector<std::string> avoidMoves; // "am", in SAN
+};
+
+struct EpdResult
+{
+    std::string id;
+    Move move;
+    bool solved = false;
+    double solveTime = 0;    // when the final correct move was first found
+    uint64_t solveNodes = 0; // nodes searched at that point
+    int depth = 0;
+};
+
+std::vector<EpdPosition> loadEpd(const std::string &path);
+
+// Searches with table, cleared first, so the result does not depend on earlier searches
+EpdResult runEpdPosition(const EpdPosition &position, double timeLimit, uint64_t nodeLimit, TranspositionTable &table);
+
+std::vector<EpdResult> runEpdSuite(const std::vector<EpdPosition> &positions, double timeLimit, uint64_t nodeLimit, int threads, size_t hashMB = 16);
+
+void printEpdReport(const std::vector<EpdPosition> &positions, const std::vector<EpdResult> &results);
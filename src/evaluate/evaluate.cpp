@@ -1,17 +1,164 @@
 #include "evaluate.h"
+#include "endgame/endgame.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
-int searchMoveCount = 0;
+EvalCache evalCache(4);
+
+EvalCache::EvalCache(size_t sizeMB) : entries(), mask(0)
+{
+    resize(sizeMB);
+}
+
+void EvalCache::resize(size_t sizeMB)
+{
+    size_t count = 1;
+    size_t maxCount = (sizeMB * 1024 * 1024) / sizeof(uint64_t);
+    while (count * 2 <= maxCount)
+    {
+        count *= 2;
+    }
+
+    entries = std::make_unique<std::atomic<uint64_t>[]>(count);
+    mask = count - 1;
+    clear();
+}
+
+void EvalCache::clear()
+{
+    for (size_t i = 0; i <= mask; i++)
+    {
+        entries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool EvalCache::probe(uint64_t key, int &score) const
+{
+    uint64_t entry = entries[key & mask].load(std::memory_order_relaxed);
+    if (entry != 0 && (entry & ~0xFFFFULL) == (key & ~0xFFFFULL))
+    {
+        score = static_cast<int16_t>(entry & 0xFFFF);
+        return true;
+    }
+    return false;
+}
+
+void EvalCache::store(uint64_t key, int score)
+{
+    uint64_t packed = (key & ~0xFFFFULL) | static_cast<uint16_t>(static_cast<int16_t>(score));
+    entries[key & mask].store(packed, std::memory_order_relaxed);
+}
+
+void SearchStats::clear()
+{
+    std::vector<uint64_t> reused = std::move(iterationNodes);
+    reused.clear();
+    *this = SearchStats();
+    iterationNodes = std::move(reused);
+}
+
+void SearchStats::recordCutoff(int moveIndex)
+{
+    betaCutoffs++;
+    if (moveIndex == 0)
+    {
+        firstMoveCutoffs++;
+    }
+    cutoffIndex[std::min(moveIndex, cutoffHistogramSize - 1)]++;
+}
+
+uint64_t SearchStats::totalNodes() const
+{
+    return nodes + qnodes;
+}
+
+double SearchStats::firstMoveCutoffRate() const
+{
+    return betaCutoffs == 0 ? 0 : static_cast<double>(firstMoveCutoffs) / static_cast<double>(betaCutoffs);
+}
+
+double SearchStats::ttHitRate() const
+{
+    return ttProbes == 0 ? 0 : static_cast<double>(ttHits) / static_cast<double>(ttProbes);
+}
+
+double SearchStats::evalCacheHitRate() const
+{
+    uint64_t probes = evalCacheHits + evalCacheMisses;
+    return probes == 0 ? 0 : static_cast<double>(evalCacheHits) / static_cast<double>(probes);
+}
+
+// Effective branching factor: the geometric mean growth of the cost of each
+// completed iteration over the previous one
+double SearchStats::branchingFactor() const
+{
+    if (iterationNodes.size() < 2)
+    {
+        return 0;
+    }
+
+    std::vector<double> costs;
+    uint64_t previous = 0;
+    for (uint64_t cumulative : iterationNodes)
+    {
+        costs.push_back(static_cast<double>(std::max<uint64_t>(cumulative - previous, 1)));
+        previous = cumulative;
+    }
+    return std::pow(costs.back() / costs.front(), 1.0 / static_cast<double>(costs.size() - 1));
+}
 
 int mirror(int sq)
 {
     return sq ^ 56; // flips rank
 }
 
+static int cachedEvaluate(const Board &board, bool &hit)
+{
+    const EvalParams &params = evalParams();
+    uint64_t key = board.hash() ^ params.cacheKey;
+
+    int score;
+    hit = evalCache.probe(key, score);
+    if (hit)
+    {
+        return score;
+    }
+
+    score = evaluateUncached(board, params);
+    evalCache.store(key, score);
+    return score;
+}
+
 int evaluate(const Board &board)
+{
+    bool hit;
+    return cachedEvaluate(board, hit);
+}
+
+int evaluate(const Board &board, SearchStats &stats)
+{
+    bool hit;
+    int score = cachedEvaluate(board, hit);
+    if (hit)
+        stats.evalCacheHits++;
+    else
+        stats.evalCacheMisses++;
+    return score;
+}
+
+int evaluateUncached(const Board &board)
+{
+    return evaluateUncached(board, evalParams());
+}
+
+int evaluateUncached(const Board &board, const EvalParams &params)
 {
     int score = 0;
-    searchMoveCount++;
+    int pieces = 0; // besides the kings
 
     for (int sq = 0; sq < 64; ++sq)
     {
@@ -19,58 +166,79 @@ int evaluate(const Board &board)
         if (p.type == PieceType::None)
             continue;
 
-        int value = 0;
-        int pst = 0;
+        int type = static_cast<int>(p.type) - 1;
         int tableSq = (p.color == Color::White) ? sq : mirror(sq);
+        pieces += (p.type == PieceType::King) ? 0 : 1;
 
-        switch (p.type)
-        {
-        case PieceType::Pawn:
-            value = 100;
-            pst = pawnPST[tableSq];
-            break;
-        case PieceType::Knight:
-            value = 320;
-            pst = knightPST[tableSq];
-            break;
-        case PieceType::Bishop:
-            value = 330;
-            pst = bishopPST[tableSq];
-            break;
-        case PieceType::Rook:
-            value = 500;
-            pst = rookPST[tableSq];
-            break;
-        case PieceType::Queen:
-            value = 900;
-            pst = queenPST[tableSq];
-            break;
-        case PieceType::King:
-            value = 0; // intentional
-            pst = kingMidgamePST[tableSq];
-            break;
-        default:
-            break;
-        }
-
-        int total = value + pst;
+        int total = params.pieceValue[type] + params.pst[type][tableSq];
         score += (p.color == Color::White) ? total : -total;
     }
 
+    // known endgames replace the material count with exact or mating-guidance scores
+    int known;
+    if (pieces <= 2 && evaluateEndgame(board, known))
+    {
+        return known;
+    }
+
+    // below every known-win, tablebase and mate score, and within the eval cache's 16 bits
+    score = std::clamp(score, -(KNOWN_WIN - 1), KNOWN_WIN - 1);
     return (board.sideToMove() == Color::White) ? score : -score;
 }
 
-int quiescence(Board &board, int alpha, int beta, int ply)
+Searcher::Searcher() : stats(), options(), table(&transpositionTable), pvTable(), pvLength(), killers(), moveStack(), captureStack(), scored()
+{
+    for (MoveList &moves : moveStack)
+    {
+        moves.reserve(maxMovesPerPosition);
+    }
+    for (MoveList &moves : captureStack)
+    {
+        moves.reserve(maxMovesPerPosition);
+    }
+    scored.reserve(maxMovesPerPosition);
+}
+
+void Searcher::newSearch(Board &board, const SearchOptions &searchOptions)
+{
+    stats.clear();
+    options = searchOptions;
+    table = (searchOptions.table != nullptr) ? searchOptions.table : &transpositionTable;
+    std::fill(&killers[0][0], &killers[0][0] + maxSearchPly * 2, Move());
+    board.reserveHistory(maxSearchPly);
+}
+
+const SearchStats &Searcher::statistics() const
 {
-    if (ply > maxPly)
+    return stats;
+}
+
+Searcher &threadSearcher()
+{
+    thread_local std::unique_ptr<Searcher> searcher = std::make_unique<Searcher>();
+    return *searcher;
+}
+
+int quiescence(Board &board, int alpha, int beta, int ply, int qDepth)
+{
+    return threadSearcher().quiescence(board, alpha, beta, ply, qDepth);
+}
+
+int Searcher::quiescence(Board &board, int alpha, int beta, int ply, int qDepth)
+{
+    stats.qnodes++;
+    stats.selDepth = std::max(stats.selDepth, ply);
+
+    // the cap counts plies below the horizon, so extended lines still get their captures resolved
+    if (qDepth > maxPly || ply >= maxSearchPly - 1)
     {
-        return evaluate(board);
+        return evaluate(board, stats);
     }
 
     // Stand-pat only if not in check
     if (!board.kingInCheck())
     {
-        int staticEval = evaluate(board);
+        int staticEval = evaluate(board, stats);
 
         if (staticEval >= beta)
         {
@@ -88,14 +256,14 @@ int quiescence(Board &board, int alpha, int beta, int ply)
         }
     }
 
-    MoveList moves;
+    MoveList &moves = captureStack[ply];
     if (board.kingInCheck())
     {
-        moves = generateOrderedMoves(board);
+        generateOrderedMoves(board, moves, scored);
     }
     else
     {
-        moves = generateOrderedCaptureMoves(board);
+        generateOrderedCaptureMoves(board, moves, scored);
     }
 
     if (moves.empty())
@@ -107,9 +275,8 @@ int quiescence(Board &board, int alpha, int beta, int ply)
 
     for (const Move &m : moves)
     {
-        searchMoveCount++;
         board.makeMove(m);
-        int score = -quiescence(board, -beta, -alpha, ply + 1);
+        int score = -quiescence(board, -beta, -alpha, ply + 1, qDepth + 1);
         board.unMakeMove();
 
         if (score >= beta)
@@ -122,63 +289,146 @@ int quiescence(Board &board, int alpha, int beta, int ply)
     return alpha;
 }
 
-bool timeIsUp(std::chrono::steady_clock::time_point &startTime, double &timeLimit)
+// Mate and tablebase win scores are stored relative to the node rather than the root,
+// so an entry stays correct when the position is reached again at a different ply
+int scoreToTT(int score, int ply)
 {
-    auto now = std::chrono::steady_clock::now();
-    double elapsed = std::chrono::duration<double>(now - startTime).count();
-    return elapsed > timeLimit;
+    if (score >= TB_WIN_BOUND)
+        return score + ply;
+    if (score <= -TB_WIN_BOUND)
+        return score - ply;
+    return score;
+}
+
+int scoreFromTT(int score, int ply)
+{
+    if (score >= TB_WIN_BOUND)
+        return score - ply;
+    if (score <= -TB_WIN_BOUND)
+        return score + ply;
+    return score;
+}
+
+bool isMateScore(int score)
+{
+    return score >= MATE_BOUND || score <= -MATE_BOUND;
+}
+
+int mateInMoves(int score)
+{
+    if (score > 0)
+        return (MATE - score + 1) / 2;
+    return -(MATE + score) / 2;
 }
 
 int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply)
 {
-    if (depth == 0)
+    TimeManager untimed;
+    return negamaxAlphaBeta(board, depth, alpha, beta, ply, untimed);
+}
+
+int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, TimeManager &timeManager, int extensions, Move excludedMove)
+{
+    return threadSearcher().negamax(board, depth, alpha, beta, ply, timeManager, extensions, excludedMove);
+}
+
+int Searcher::negamax(Board &board, int depth, int alpha, int beta, int ply, TimeManager &timeManager, int extensions, Move excludedMove)
+{
+    pvLength[ply] = ply;
+    stats.nodes++;
+    stats.selDepth = std::max(stats.selDepth, ply);
+
+    if (timeManager.checkUp())
     {
-        return quiescence(board, alpha, beta, ply);
+        return 0; // unwinds to the root, which ignores scores from aborted subtrees
     }
 
-    MoveList moves = generateLegalMoves(board);
-
-    if (moves.empty())
+    // a single repetition is enough inside the search, the side ahead would avoid it
+    if (board.isRepetition())
     {
-        if (board.kingInCheck())
-            return -MATE + ply; // prefer faster mates
         return 0;
     }
 
-    int best = -1000000;
-
-    for (const Move &m : moves)
+    // Mate distance pruning: nothing here can beat being mated right now
+    // or mating on the next move, so a window outside that range is already decided
+    alpha = std::max(alpha, -MATE + ply);
+    beta = std::min(beta, MATE - ply - 1);
+    if (alpha >= beta)
     {
-        board.makeMove(m);
-        int score = -negamaxAlphaBeta(board, depth - 1, -beta, -alpha, ply + 1);
-        board.unMakeMove();
-
-        if (score > best)
-            best = score;
-
-        if (best > alpha)
-            alpha = best;
+        return alpha;
+    }
 
-        if (alpha >= beta)
-            break;
+    if (depth == 0 || ply >= maxSearchPly - 1)
+    {
+        // the capture tree counts against a node limit, the next checkUp acts on it
+        uint64_t qnodesBefore = stats.qnodes;
+        int score = quiescence(board, alpha, beta, ply);
+        timeManager.addNodes(stats.qnodes - qnodesBefore);
+        return score;
     }
 
-    return best;
-}
+    int originalAlpha = alpha;
+    bool excluding = excludedMove != Move();
+    TTEntry ttEntry;
+    bool ttHit = !excluding && table->probe(board.hash(), ttEntry);
+    stats.ttProbes += excluding ? 0 : 1;
+    stats.ttHits += ttHit ? 1 : 0;
 
-int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, std::chrono::steady_clock::time_point &startTime, double &timeLimit)
-{
-    if (timeIsUp(startTime, timeLimit))
+    if (ttHit && ttEntry.depth >= depth)
     {
-        return evaluate(board);
+        int ttScore = scoreFromTT(ttEntry.score, ply);
+
+        if (ttEntry.bound == Bound::Exact)
+        {
+            stats.ttCutoffs++;
+            // tablebase entries are exact without a move
+            if (ttEntry.move != Move())
+            {
+                pvTable[ply][ply] = ttEntry.move;
+                pvLength[ply] = ply + 1;
+            }
+            return ttScore;
+        }
+        if ((ttEntry.bound == Bound::Lower && ttScore >= beta) || (ttEntry.bound == Bound::Upper && ttScore <= alpha))
+        {
+            stats.ttCutoffs++;
+            return ttScore;
+        }
     }
 
-    if (depth == 0)
+    // Right after a capture or pawn move the tablebase result is exact; wins and losses
+    // only bound the score, a faster mate found by the search is still better
+    if (!excluding && tablebaseLargest() > 0 && board.halfMoveCounter() == 0 &&
+        pieceCount(board) <= std::min(options.tablebaseProbeLimit, tablebaseLargest()))
     {
-        return quiescence(board, alpha, beta, ply);
+        WDL wdl;
+        if (probeWDL(board, wdl))
+        {
+            stats.tbHits++;
+            int score = static_cast<int>(wdl); // cursed wins and blessed losses are all but drawn
+            Bound bound = Bound::Exact;
+            if (wdl == WDL::Win)
+            {
+                score = TB_WIN - ply;
+                bound = Bound::Lower;
+            }
+            else if (wdl == WDL::Loss)
+            {
+                score = -TB_WIN + ply;
+                bound = Bound::Upper;
+            }
+
+            if (bound == Bound::Exact || (bound == Bound::Lower && score >= beta) || (bound == Bound::Upper && score <= alpha))
+            {
+                table->store(board.hash(), TTEntry{Move(), scoreToTT(score, ply), std::min(depth + 6, maxSearchPly - 1), bound});
+                return score;
+            }
+        }
     }
 
-    MoveList moves = generateLegalMoves(board);
+    // a verification search has its own buffer, the node it verifies is still iterating over this ply's
+    MoveList &moves = moveStack[excluding ? maxSearchPly + ply : ply];
+    generateLegalMoves(board, moves);
 
     if (moves.empty())
     {
@@ -187,22 +437,120 @@ int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, std:
         return 0;
     }
 
-    int best = -1000000;
+    // checkmate on the hundredth ply still counts, so this comes after the mate test
+    if (board.isFiftyMoveDraw())
+    {
+        return 0;
+    }
+
+    // search the hash move first
+    if (ttHit)
+    {
+        auto ttMove = std::find(moves.begin(), moves.end(), ttEntry.move);
+        if (ttMove != moves.end())
+        {
+            std::iter_swap(moves.begin(), ttMove);
+        }
+    }
+
+    // then the killers, quiet moves that refuted a sibling at this ply
+    auto nextMove = moves.begin() + ((ttHit && moves[0] == ttEntry.move) ? 1 : 0);
+    for (const Move &killer : killers[ply])
+    {
+        auto killerMove = std::find(nextMove, moves.end(), killer);
+        if (killerMove != moves.end())
+        {
+            std::rotate(nextMove, killerMove, killerMove + 1);
+            ++nextMove;
+        }
+    }
+
+    // Singular extension: if every alternative to the hash move fails well below its
+    // score in a reduced search, the hash move is forced and is searched one ply deeper
+    bool singular = false;
+    if (options.singularExtensions && ttHit && depth >= options.singularMinDepth && extensions < options.maxExtensions && ttEntry.depth >= depth - 3 &&
+        ttEntry.bound != Bound::Upper && !isMateScore(ttEntry.score) && moves[0] == ttEntry.move)
+    {
+        int singularBeta = scoreFromTT(ttEntry.score, ply) - 2 * depth;
+        int score = negamax(board, (depth - 1) / 2, singularBeta - 1, singularBeta, ply, timeManager, extensions, ttEntry.move);
+        if (timeManager.stopped())
+            return 0;
+
+        singular = score < singularBeta;
+        pvLength[ply] = ply;
+    }
+
+    int best = -INF_SCORE;
+    Move bestMove = moves[0];
+    int moveIndex = -1;
 
     for (const Move &m : moves)
     {
+        if (excluding && m == excludedMove)
+            continue;
+        moveIndex++;
+
         board.makeMove(m);
-        int score = -negamaxAlphaBeta(board, depth - 1, -beta, -alpha, ply + 1, startTime, timeLimit);
+
+        int extension = 0;
+        if (extensions < options.maxExtensions)
+        {
+            if (options.checkExtensions && board.kingInCheck())
+                extension = 1;
+            else if (singular && m == ttEntry.move)
+                extension = 1;
+        }
+
+        int score = -negamax(board, depth - 1 + extension, -beta, -alpha, ply + 1, timeManager, extensions + extension);
         board.unMakeMove();
 
+        if (timeManager.stopped())
+            return 0;
+
         if (score > best)
+        {
             best = score;
+            bestMove = m;
+        }
 
         if (best > alpha)
+        {
             alpha = best;
 
+            pvTable[ply][ply] = m;
+            for (int next = ply + 1; next < pvLength[ply + 1]; next++)
+            {
+                pvTable[ply][next] = pvTable[ply + 1][next];
+            }
+            pvLength[ply] = pvLength[ply + 1];
+        }
+
         if (alpha >= beta)
+        {
+            stats.recordCutoff(moveIndex);
+            if (m.type != MoveType::Capture && m.type != MoveType::EnPassant && m.type != MoveType::Promotion && killers[ply][0] != m)
+            {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = m;
+            }
             break;
+        }
+    }
+
+    // the only legal move was excluded, which makes it singular by definition
+    if (best == -INF_SCORE)
+    {
+        return alpha;
+    }
+
+    if (!excluding)
+    {
+        Bound bound = Bound::Exact;
+        if (best <= originalAlpha)
+            bound = Bound::Upper;
+        else if (best >= beta)
+            bound = Bound::Lower;
+        table->store(board.hash(), TTEntry{bestMove, scoreToTT(best, ply), depth, bound});
     }
 
     return best;
@@ -210,11 +558,12 @@ int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, std:
 
 Move findBestMove(Board &board, int depth)
 {
-    searchMoveCount = 0;
+    Searcher &searcher = threadSearcher();
+    searcher.newSearch(board);
     auto start = std::chrono::steady_clock::now();
 
-    const int NEG_INF = -1000000;
-    const int POS_INF = 1000000;
+    const int NEG_INF = -INF_SCORE;
+    const int POS_INF = INF_SCORE;
 
     MoveList moves = generateLegalMoves(board);
     if (moves.empty())
@@ -228,7 +577,7 @@ Move findBestMove(Board &board, int depth)
     for (const Move &m : moves)
     {
         board.makeMove(m);
-        int score = -negamaxAlphaBeta(board, depth - 1, -beta, -alpha, 0);
+        int score = -negamaxAlphaBeta(board, depth - 1, -beta, -alpha, 1);
         board.unMakeMove();
 
         if (score > bestScore)
@@ -246,98 +595,433 @@ Move findBestMove(Board &board, int depth)
 
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
-    std::cout << searchMoveCount << " searched moves (" << elapsed_seconds.count() << " seconds)\n";
+    std::cout << searcher.statistics().totalNodes() << " nodes (" << elapsed_seconds.count() << " seconds)\n";
     return bestMove;
 }
 
 Move findBestMove(Board &board, int maxDepth, double timeLimit)
 {
-    searchMoveCount = 0;
-    auto start = std::chrono::steady_clock::now();
+    TimeManager timeManager;
+    timeManager.start(timeLimit);
+    return findBestMove(board, maxDepth, timeManager);
+}
+
+Move findBestMove(Board &board, int maxDepth, TimeManager &timeManager)
+{
+    SearchResult result = searchPosition(board, maxDepth, timeManager, [](const SearchResult &iteration)
+                                         { std::cout << "depth " << iteration.depth << "/" << iteration.selDepth << " score " << iteration.score
+                                                     << " nodes " << iteration.nodes << " nps " << iteration.nps << " hashfull " << iteration.hashfull << "\n"; });
 
-    const int NEG_INF = -1000000;
-    const int POS_INF = 1000000;
+    std::cout << result.nodes << " nodes (depth " << result.depth << (result.partial ? "+" : "") << ", " << timeManager.elapsed() << " seconds)\n";
+    if (isMateScore(result.score))
+    {
+        std::cout << "mate in " << mateInMoves(result.score) << "\n";
+    }
+    std::cout << board.toString(result.bestMove) << std::endl;
+
+    return result.bestMove;
+}
+
+// Lengthens a PV cut short by TT cutoffs by following hash moves, stopping at
+// the first missing or illegal move or a repeated position
+void Searcher::extendPV(Board &board, MoveList &pv, int maxLength)
+{
+    for (const Move &m : pv)
+    {
+        board.makeMove(m);
+    }
+
+    size_t played = pv.size();
+    TTEntry entry;
+    MoveList &legal = moveStack[0]; // free between iterations
+    while (static_cast<int>(pv.size()) < maxLength && !board.isRepetition() && table->probe(board.hash(), entry))
+    {
+        generateLegalMoves(board, legal);
+        if (std::find(legal.begin(), legal.end(), entry.move) == legal.end())
+        {
+            break;
+        }
+        pv.push_back(entry.move);
+        board.makeMove(entry.move);
+        played++;
+    }
+
+    for (size_t i = 0; i < played; i++)
+    {
+        board.unMakeMove();
+    }
+}
+
+void Searcher::fillReport(SearchResult &result, const TimeManager &timeManager) const
+{
+    result.stats = stats;
+    result.selDepth = stats.selDepth;
+    result.nodes = stats.totalNodes();
+    result.time = timeManager.elapsed();
+    result.nps = static_cast<uint64_t>(static_cast<double>(result.nodes) / std::max(result.time, 0.001));
+    result.hashfull = table->hashfull();
+}
+
+std::vector<SearchLine> findBestLines(Board &board, int maxDepth, double timeLimit, int lineCount)
+{
+    TimeManager timeManager;
+    timeManager.start(timeLimit);
+    SearchOptions options;
+    options.multiPV = lineCount;
+    return searchPosition(board, maxDepth, timeManager, nullptr, options).lines;
+}
+
+// Lazy SMP helper threads. They are started once and kept, each with its own Searcher
+// (threadSearcher), and wait on a condition variable between searches.
+class HelperPool
+{
+private:
+    struct Helper
+    {
+        std::thread thread;
+        TimeManager clock; // unlimited, stop() raises its flag
+        Board board;
+        SearchStats stats;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::unique_ptr<Helper>> helpers;
+    uint64_t generation = 0; // bumped by every start()
+    size_t active = 0;       // helpers taking part in the current search
+    size_t running = 0;
+    bool quit = false;
+    int maxDepth = 0;
+    SearchOptions options;
+
+    void loop(size_t index)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        Helper &helper = *helpers[index]; // start() may still be growing the vector
+        uint64_t seen = 0;
+        while (true)
+        {
+            wake.wait(lock, [&]() { return quit || generation != seen; });
+            if (quit)
+            {
+                return;
+            }
+            seen = generation;
+            if (index >= active)
+            {
+                continue;
+            }
+
+            SearchOptions helperOptions = options;
+            helperOptions.helper = static_cast<int>(index) + 1;
+            int depth = maxDepth;
+            lock.unlock();
+            helper.stats = threadSearcher().search(helper.board, depth, helper.clock, nullptr, helperOptions).stats;
+            lock.lock();
+            if (--running == 0)
+            {
+                done.notify_all();
+            }
+        }
+    }
+
+public:
+    ~HelperPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::unique_ptr<Helper> &helper : helpers)
+        {
+            helper->thread.join();
+        }
+    }
+
+    // Sets count helpers searching board; threads are only ever added
+    void start(size_t count, const Board &board, int depth, const SearchOptions &searchOptions)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (helpers.size() < count)
+        {
+            helpers.push_back(std::make_unique<Helper>());
+            helpers.back()->thread = std::thread(&HelperPool::loop, this, helpers.size() - 1);
+        }
+
+        SearchLimits unlimited;
+        unlimited.infinite = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            helpers[i]->board = board; // reuses the history's capacity
+            helpers[i]->clock.start(unlimited, board.sideToMove());
+        }
+        maxDepth = depth;
+        options = searchOptions;
+        options.multiPV = 1;
+        options.threads = 1;
+        active = count;
+        running = count;
+        generation++;
+        wake.notify_all();
+    }
+
+    // Stops the helpers, waits until all are idle and adds their work to result
+    void stop(SearchResult &result)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (size_t i = 0; i < active; i++)
+        {
+            helpers[i]->clock.stop = true;
+        }
+        done.wait(lock, [&]() { return running == 0; });
+
+        for (size_t i = 0; i < active; i++)
+        {
+            const SearchStats &stats = helpers[i]->stats;
+            result.nodes += stats.totalNodes();
+            result.stats.evalCacheHits += stats.evalCacheHits;
+            result.stats.evalCacheMisses += stats.evalCacheMisses;
+        }
+        result.nps = static_cast<uint64_t>(static_cast<double>(result.nodes) / std::max(result.time, 0.001));
+    }
+};
+
+static HelperPool helperPool;
+static std::mutex helperPoolOwner; // one multi-threaded search at a time
+
+SearchResult searchPosition(Board &board, int maxDepth, TimeManager &timeManager, const IterationCallback &onIteration, const SearchOptions &options)
+{
+    size_t helperCount = static_cast<size_t>(std::max(options.threads, 1) - 1);
+    if (helperCount == 0)
+    {
+        return threadSearcher().search(board, maxDepth, timeManager, onIteration, options);
+    }
+
+    // Helpers search without limits; what they store in the table reorders and
+    // cuts the main search, which alone decides when to stop
+    std::lock_guard<std::mutex> owner(helperPoolOwner);
+    helperPool.start(helperCount, board, maxDepth, options);
+    SearchResult result;
+    try
+    {
+        result = threadSearcher().search(board, maxDepth, timeManager, onIteration, options);
+    }
+    catch (...)
+    {
+        helperPool.stop(result);
+        throw;
+    }
+    helperPool.stop(result);
+    return result;
+}
+
+SearchResult Searcher::search(Board &board, int maxDepth, TimeManager &timeManager, const IterationCallback &onIteration, const SearchOptions &searchOptions)
+{
+    newSearch(board, searchOptions);
+
+    const int NEG_INF = -INF_SCORE;
+    const int POS_INF = INF_SCORE;
+
+    SearchResult result;
 
     MoveList moves = generateLegalMoves(board);
     if (moves.empty())
     {
-        return Move();
+        return result;
     }
+
+    // In a tablebase position only the moves that keep the result are searched,
+    // the fastest win by DTZ so the search cannot wander away from the conversion
+    WDL rootWDL;
+    if (tablebaseLargest() > 0 && pieceCount(board) <= std::min(options.tablebaseProbeLimit, tablebaseLargest()) &&
+        probeRoot(board, moves, rootWDL))
+    {
+        stats.tbHits++;
+    }
+
+    result.bestMove = moves[0];
+    result.pv.assign(1, moves[0]);
+    result.lines.assign(1, SearchLine{0, 0, result.pv});
     if (moves.size() == 1)
     {
-        return moves[0];
+        return result;
     }
 
-    Move bestMove;
-    size_t bestIndex;
-    int bestScore = NEG_INF;
-    int highestDepth;
+    // Multi-PV: line k searches every root move except the k better ones already found,
+    // so all lines share one iteration and its TT entries instead of K separate searches
+    size_t lineCount = std::min(static_cast<size_t>(std::max(options.multiPV, 1)), moves.size());
+    int bestMoveStability = 0;
+    double lastIterationTime = 0;
 
     // Iterative deepening
     for (int depth = 1; depth <= maxDepth; depth++)
     {
-        int alpha = NEG_INF;
-        int beta = POS_INF;
+        // Lazy SMP helpers skip depths in staggered blocks, so they run ahead of the
+        // main search and of each other instead of all filling the table at one depth
+        if (options.helper > 0 && depth > 1)
+        {
+            static const int skipSize[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+            static const int skipPhase[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+            int slot = (options.helper - 1) % 20;
+            if (((depth + skipPhase[slot]) / skipSize[slot]) % 2 != 0)
+            {
+                continue;
+            }
+        }
 
-        int currentBestScore = NEG_INF;
-        Move currentBestMove = moves[0];
+        double iterationStart = timeManager.elapsed();
+        std::vector<SearchLine> previousLines = result.lines;
 
-        for (size_t i = 0; i < moves.size(); i++)
+        for (size_t line = 0; line < lineCount; line++)
         {
-            board.makeMove(moves[i]);
-            int score = -negamaxAlphaBeta(board, depth - 1, -beta, -alpha, 0, start, timeLimit);
-            board.unMakeMove();
+            int alpha = NEG_INF;
+            int beta = POS_INF;
+
+            int currentBestScore = NEG_INF;
+            MoveList currentPV;
+            size_t completedMoves = 0;
+            size_t bestIndex = line;
 
-            if (score > bestScore)
+            for (size_t i = line; i < moves.size(); i++)
             {
-                currentBestScore = score;
-                currentBestMove = moves[i];
-                bestIndex = i;
+                board.makeMove(moves[i]);
+                int score = -negamax(board, depth - 1, -beta, -alpha, 1, timeManager);
+                board.unMakeMove();
+
+                if (timeManager.stopped())
+                {
+                    break;
+                }
+                completedMoves++;
+
+                if (score > currentBestScore)
+                {
+                    currentBestScore = score;
+                    bestIndex = i;
+
+                    currentPV.assign(1, moves[i]);
+                    currentPV.insert(currentPV.end(), pvTable[1] + 1, pvTable[1] + pvLength[1]);
+                }
+
+                if (score > alpha)
+                {
+                    alpha = score;
+                }
+
+                if (alpha >= beta)
+                {
+                    break;
+                }
             }
 
-            if (score > alpha)
+            if (timeManager.stopped())
             {
-                alpha = score;
+                // The previous best move is searched first, so any move that finished
+                // with a higher score in the unfinished iteration is a proven improvement.
+                // Lower lines keep their previous depth.
+                if (line == 0 && completedMoves > 0)
+                {
+                    result.lines.assign(1, SearchLine{currentBestScore, depth - 1, currentPV});
+                    result.bestMove = currentPV[0];
+                    result.score = currentBestScore;
+                    result.pv = currentPV;
+                    result.partial = true;
+                }
+                else if (line > 0)
+                {
+                    result.lines.resize(line);
+                    result.partial = true;
+                }
+
+                // Fill the remaining ranks from the last iteration, leaving out the moves
+                // the lines above already show and the unsearched placeholder of depth 0
+                for (const SearchLine &stale : previousLines)
+                {
+                    if (result.lines.size() >= lineCount)
+                    {
+                        break;
+                    }
+                    bool skip = stale.depth == 0 || std::any_of(result.lines.begin(), result.lines.end(), [&](const SearchLine &fresh)
+                                                                 { return fresh.pv[0] == stale.pv[0]; });
+                    if (!skip)
+                    {
+                        result.lines.push_back(stale);
+                    }
+                }
+                break;
             }
 
-            if (alpha >= beta)
+            // Set the line's move at its rank for the next lines and the next depth
+            std::swap(moves[line], moves[bestIndex]);
+
+            extendPV(board, currentPV, depth);
+            if (result.lines.size() <= line)
             {
-                break;
+                result.lines.push_back(SearchLine());
+            }
+            result.lines[line] = SearchLine{currentBestScore, depth, currentPV};
+
+            if (line == 0)
+            {
+                bestMoveStability = (depth > 1 && moves[0] == result.bestMove) ? bestMoveStability + 1 : 0;
+
+                result.bestMove = moves[0];
+                result.score = currentBestScore;
+                result.pv = currentPV;
+                result.depth = depth;
             }
         }
 
-        // Do not apply changes if depth is unfinished
-        if (timeIsUp(start, timeLimit))
+        if (timeManager.stopped())
         {
             break;
         }
 
-        // Set best move to top of list for next depth
-        std::swap(moves[0], moves[bestIndex]);
+        stats.iterationNodes.push_back(stats.totalNodes());
+        fillReport(result, timeManager);
 
-        bestMove = currentBestMove;
-        bestScore = currentBestScore;
-        highestDepth = depth;
-    }
+        if (onIteration)
+        {
+            onIteration(result);
+        }
+        lastIterationTime = timeManager.elapsed() - iterationStart;
 
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end - start;
-    std::cout << searchMoveCount << " searched moves (depth " << highestDepth << ", " << elapsed_seconds.count() << " seconds)\n";
-    std::cout << board.toString(bestMove) << std::endl;
+        if (!timeManager.shouldStartIteration(lastIterationTime, bestMoveStability))
+        {
+            break;
+        }
 
-    return bestMove;
+        // a mate that fits inside the completed depth cannot be improved on
+        if (lineCount == 1 && result.score >= MATE - depth && !timeManager.pondering)
+        {
+            break;
+        }
+    }
+
+    fillReport(result, timeManager);
+    return result;
 }
 
-bool gameOver(Board &board)
+GameStatus gameStatus(Board &board)
 {
-    MoveList legalMoves = generateLegalMoves(board);
-    if (legalMoves.empty())
+    if (!hasLegalMove(board))
     {
-        return true;
+        return board.kingInCheck() ? GameStatus::Checkmate : GameStatus::Stalemate;
     }
-    if (board.halfMoveCounter() >= 50)
+    if (board.isFiftyMoveDraw())
     {
-        return true;
+        return GameStatus::FiftyMoveRule;
     }
-    return false;
+    if (board.isThreefoldRepetition())
+    {
+        return GameStatus::ThreefoldRepetition;
+    }
+    return GameStatus::Ongoing;
 }
+
+bool gameOver(Board &board)
+{
+    return gameStatus(board) != GameStatus::Ongoing;
+}
\ No newline at end of file
@@ -2,89 +2,217 @@
 
 #include "board/board.h"
 #include "generate/generate.h"
+#include "timeman/timeman.h"
+#include "tt/tt.h"
+#include "tablebase/tablebase.h"
+#include "params/params.h"
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <functional>
 
 const int MATE = 32000;
+const int INF_SCORE = MATE + 1;
 
 const int deltaMargin = 900;
 const int maxPly = 8;
+const int maxSearchPly = 128;
+const int MATE_BOUND = MATE - maxSearchPly;
+const int TB_WIN = MATE_BOUND - 1; // tablebase win, below every mate score
+const int TB_WIN_BOUND = TB_WIN - maxSearchPly;
+const int maxExtensions = 16; // extension plies allowed along a single path
+const int singularMinDepth = 6;
+
+// Per-search feature switches, so two configurations can be compared in one process
+struct SearchOptions
+{
+    bool checkExtensions = true;
+    bool singularExtensions = true;
+    int maxExtensions = ::maxExtensions;
+    int singularMinDepth = ::singularMinDepth;
+    int multiPV = 1; // number of best root moves to report
+    // Most pieces probed; 0 disables probing. Off by default: the decoder has not yet been
+    // checked against real tables, and a bad decode would prune winning root moves.
+    int tablebaseProbeLimit = 0;
+    TranspositionTable *table = nullptr; // nullptr uses the shared transpositionTable
+    int threads = 1; // Lazy SMP: the extra threads search the same position and only share the table
+    int helper = 0;  // Lazy SMP helper number, 0 for the main search; helpers skip some depths
+};
+
+// Direct-mapped cache of static evaluations keyed by the board hash.
+// Each slot packs the upper 48 bits of the key with a 16-bit score into a
+// single atomic word, so concurrent probes and stores never see torn entries.
+class EvalCache
+{
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> entries;
+    size_t mask;
+
+public:
+    explicit EvalCache(size_t sizeMB);
+
+    void resize(size_t sizeMB);
+
+    void clear();
+
+    bool probe(uint64_t key, int &score) const;
+
+    void store(uint64_t key, int score);
+};
+
+extern EvalCache evalCache;
+
+enum struct GameStatus
+{
+    Ongoing,
+    Checkmate,
+    Stalemate,
+    FiftyMoveRule,
+    ThreefoldRepetition
+};
+
+const int cutoffHistogramSize = 16;
+
+// Counters for one search, kept per thread and copied into the SearchResult
+struct SearchStats
+{
+    uint64_t nodes = 0;  // negamax nodes
+    uint64_t qnodes = 0; // quiescence nodes
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t ttCutoffs = 0;
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    uint64_t tbHits = 0;
+    uint64_t evalCacheHits = 0; // counted here rather than in the shared cache, so threads never contend on them
+    uint64_t evalCacheMisses = 0;
+    uint64_t cutoffIndex[cutoffHistogramSize] = {}; // beta cutoffs by move index, the last bucket takes the rest
+    int selDepth = 0;
+    std::vector<uint64_t> iterationNodes; // total nodes when each iteration completed
+
+    void clear();
+
+    void recordCutoff(int moveIndex);
+
+    uint64_t totalNodes() const;
+
+    double firstMoveCutoffRate() const;
+
+    double ttHitRate() const;
+
+    double evalCacheHitRate() const;
+
+    double branchingFactor() const;
+};
+
+// One ranked root move with its score and the depth it was last completed at
+struct SearchLine
+{
+    int score = 0;
+    int depth = 0;
+    MoveList pv;
+};
+
+struct SearchResult
+{
+    Move bestMove;
+    int score = 0;
+    int depth = 0;
+    bool partial = false;
+    int selDepth = 0;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    double time = 0; // seconds since the search started
+    int hashfull = 0; // permille of the transposition table in use
+    MoveList pv;
+    std::vector<SearchLine> lines; // best first, SearchOptions::multiPV of them
+    SearchStats stats;
+};
+
+// called with the running result after every completed iteration
+using IterationCallback = std::function<void(const SearchResult &)>;
 
-const int pawnPST[64] = {
-    0, 0, 0, 0, 0, 0, 0, 0,
-    50, 50, 50, 50, 50, 50, 50, 50,
-    10, 10, 20, 30, 30, 20, 10, 10,
-    5, 5, 10, 25, 25, 10, 5, 5,
-    0, 0, 0, 20, 20, 0, 0, 0,
-    5, -5, -10, 0, 0, -10, -5, 5,
-    5, 10, 10, -20, -20, 10, 10, 5,
-    0, 0, 0, 0, 0, 0, 0, 0};
-
-const int knightPST[64] = {
-    -50, -40, -30, -30, -30, -30, -40, -50,
-    -40, -20, 0, 0, 0, 0, -20, -40,
-    -30, 0, 10, 15, 15, 10, 0, -30,
-    -30, 5, 15, 20, 20, 15, 5, -30,
-    -30, 0, 15, 20, 20, 15, 0, -30,
-    -30, 5, 10, 15, 15, 10, 5, -30,
-    -40, -20, 0, 5, 5, 0, -20, -40,
-    -50, -40, -30, -30, -30, -30, -40, -50};
-
-const int bishopPST[64] = {
-    -20, -10, -10, -10, -10, -10, -10, -20,
-    -10, 0, 0, 0, 0, 0, 0, -10,
-    -10, 0, 5, 10, 10, 5, 0, -10,
-    -10, 5, 5, 10, 10, 5, 5, -10,
-    -10, 0, 10, 10, 10, 10, 0, -10,
-    -10, 10, 10, 10, 10, 10, 10, -10,
-    -10, 5, 0, 0, 0, 0, 5, -10,
-    -20, -10, -10, -10, -10, -10, -10, -20};
-
-const int rookPST[64] = {
-    0, 0, 0, 5, 5, 0, 0, 0,
-    -5, 0, 0, 0, 0, 0, 0, -5,
-    -5, 0, 0, 0, 0, 0, 0, -5,
-    -5, 0, 0, 0, 0, 0, 0, -5,
-    -5, 0, 0, 0, 0, 0, 0, -5,
-    -5, 0, 0, 0, 0, 0, 0, -5,
-    5, 10, 10, 10, 10, 10, 10, 5,
-    0, 0, 0, 0, 0, 0, 0, 0};
-
-const int queenPST[64] = {
-    -20, -10, -10, -5, -5, -10, -10, -20,
-    -10, 0, 0, 0, 0, 0, 0, -10,
-    -10, 0, 5, 5, 5, 5, 0, -10,
-    -5, 0, 5, 5, 5, 5, 0, -5,
-    0, 0, 5, 5, 5, 5, 0, -5,
-    -10, 5, 5, 5, 5, 5, 0, -10,
-    -10, 0, 5, 0, 0, 0, 0, -10,
-    -20, -10, -10, -5, -5, -10, -10, -20};
-
-const int kingMidgamePST[64] = {
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -30, -40, -40, -50, -50, -40, -40, -30,
-    -20, -30, -30, -40, -40, -30, -30, -20,
-    -10, -20, -20, -20, -20, -20, -20, -10,
-    20, 20, 0, 0, 0, 0, 20, 20,
-    20, 30, 10, 0, 0, 10, 30, 20};
+const int maxMovesPerPosition = 256;
+
+// Everything a search needs, allocated once and reused by every later search, which
+// only has to reset the counters and killers. Each thread has its own (threadSearcher).
+class Searcher
+{
+private:
+    SearchStats stats;
+    SearchOptions options;
+    TranspositionTable *table;
+
+    // Triangular principal variation table, row [ply] holds the best line from that ply
+    Move pvTable[maxSearchPly][maxSearchPly];
+    int pvLength[maxSearchPly];
+
+    Move killers[maxSearchPly][2];
+
+    // move lists by ply; the upper half belongs to singular verification searches
+    MoveList moveStack[2 * maxSearchPly];
+    MoveList captureStack[maxSearchPly];
+    ScoredMoveList scored;
+
+    void extendPV(Board &board, MoveList &pv, int maxLength);
+
+    void fillReport(SearchResult &result, const TimeManager &timeManager) const;
+
+public:
+    Searcher();
+
+    void newSearch(Board &board, const SearchOptions &searchOptions = SearchOptions());
+
+    int quiescence(Board &board, int alpha, int beta, int ply, int qDepth = 0);
+
+    int negamax(Board &board, int depth, int alpha, int beta, int ply, TimeManager &timeManager, int extensions = 0, Move excludedMove = Move());
+
+    SearchResult search(Board &board, int maxDepth, TimeManager &timeManager, const IterationCallback &onIteration = nullptr, const SearchOptions &searchOptions = SearchOptions());
+
+    const SearchStats &statistics() const;
+};
+
+Searcher &threadSearcher();
 
 int mirror(int sq);
 
+int evaluateUncached(const Board &board);
+
+int evaluateUncached(const Board &board, const EvalParams &params);
+
 int evaluate(const Board &board);
 
-int quiescence(Board &board, int alpha, int beta, int ply);
+// evaluate() that counts the cache probe in stats
+int evaluate(const Board &board, SearchStats &stats);
 
-int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply);
+int quiescence(Board &board, int alpha, int beta, int ply, int qDepth = 0);
+
+int scoreToTT(int score, int ply);
+
+int scoreFromTT(int score, int ply);
+
+bool isMateScore(int score);
+
+int mateInMoves(int score);
 
 int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply);
 
-int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, std::chrono::steady_clock::time_point &startTime, double &timeLimit);
+int negamaxAlphaBeta(Board &board, int depth, int alpha, int beta, int ply, TimeManager &timeManager, int extensions = 0, Move excludedMove = Move());
 
 Move findBestMove(Board &board, int depth);
 
 Move findBestMove(Board &board, int depth, double timeLimit);
 
-bool gameOver(Board &board);
+Move findBestMove(Board &board, int maxDepth, TimeManager &timeManager);
+
+// Top lineCount moves with scores, for analysis
+std::vector<SearchLine> findBestLines(Board &board, int maxDepth, double timeLimit, int lineCount);
 
-bool timeIsUp(std::chrono::steady_clock::time_point &startTime, double &timeLimit);
+// Searches on the calling thread, plus options.threads - 1 helpers from a pool kept
+// across searches that run until it finishes. Only the calling thread's iterations are reported; nodes and eval cache counts include the helpers'.
+SearchResult searchPosition(Board &board, int maxDepth, TimeManager &timeManager, const IterationCallback &onIteration = nullptr, const SearchOptions &options = SearchOptions());
+
+GameStatus gameStatus(Board &board);
+
+bool gameOver(Board &board);
@@ -1,4 +1,5 @@
 #include "generate.h"
+#include "params/params.h"
 #include <algorithm>
 
 static std::array<int, 2> pawnDirections = {7, 9};
@@ -235,65 +236,115 @@ void generateKingMoves(const Board &board, const int &sq, MoveList &moves)
     }
 }
 
+void generatePieceMoves(const Board &board, const int &sq, MoveList &moves)
+{
+    switch (board.pieceAt(sq).type)
+    {
+    case (PieceType::None):
+        break;
+    case (PieceType::Pawn):
+        generatePawnMoves(board, sq, moves);
+        break;
+    case (PieceType::Rook):
+        generateSliderMoves<4>(board, sq, moves, rookDirections);
+        break;
+    case (PieceType::Knight):
+        generateKnightMoves(board, sq, moves);
+        break;
+    case (PieceType::Bishop):
+        generateSliderMoves<4>(board, sq, moves, bishopDirections);
+        break;
+    case (PieceType::Queen):
+        generateSliderMoves<8>(board, sq, moves, queenDirections);
+        break;
+    case (PieceType::King):
+        generateKingMoves(board, sq, moves);
+        break;
+    }
+}
+
 MoveList generatePseudoLegalMoves(const Board &board)
 {
     MoveList moves;
+    generatePseudoLegalMoves(board, moves);
+    return moves;
+}
+
+void generatePseudoLegalMoves(const Board &board, MoveList &moves)
+{
+    moves.clear();
 
     for (int sq = 0; sq < 64; sq++)
     {
-        const Piece p = board.pieceAt(sq);
-
-        if (p.color != board.sideToMove())
+        if (board.pieceAt(sq).color != board.sideToMove())
         {
             continue;
         }
 
-        switch (p.type)
-        {
-        case (PieceType::None):
-            break;
-        case (PieceType::Pawn):
-            generatePawnMoves(board, sq, moves);
-            break;
-        case (PieceType::Rook):
-            generateSliderMoves<4>(board, sq, moves, rookDirections);
-            break;
-        case (PieceType::Knight):
-            generateKnightMoves(board, sq, moves);
-            break;
-        case (PieceType::Bishop):
-            generateSliderMoves<4>(board, sq, moves, bishopDirections);
-            break;
-        case (PieceType::Queen):
-            generateSliderMoves<8>(board, sq, moves, queenDirections);
-            break;
-        case (PieceType::King):
-            generateKingMoves(board, sq, moves);
-            break;
-        }
+        generatePieceMoves(board, sq, moves);
     }
+}
 
+MoveList generateLegalMoves(Board &board)
+{
+    MoveList moves;
+    generateLegalMoves(board, moves);
     return moves;
 }
 
-MoveList generateLegalMoves(Board &board)
+// Filters the pseudo-legal moves in place, so a reused buffer never allocates
+void generateLegalMoves(Board &board, MoveList &moves)
 {
-    MoveList pseudoLegalMoves = generatePseudoLegalMoves(board);
-    MoveList legalMoves;
+    generatePseudoLegalMoves(board, moves);
 
     Color movingColor = board.sideToMove();
+    size_t legalCount = 0;
 
-    for (Move m : pseudoLegalMoves)
+    for (const Move &m : moves)
     {
         board.makeMove(m);
         if (!board.kingInCheck(movingColor))
         {
-            legalMoves.push_back(m);
+            moves[legalCount++] = m;
         }
         board.unMakeMove();
     }
 
-    return legalMoves;
+    moves.resize(legalCount);
+}
+
+// Stops at the first legal move instead of building the whole list,
+// which is all that game-over checks need.
+bool hasLegalMove(Board &board)
+{
+    Color movingColor = board.sideToMove();
+    MoveList pieceMoves;
+    pieceMoves.reserve(32);
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (board.pieceAt(sq).color != movingColor)
+        {
+            continue;
+        }
+
+        pieceMoves.clear();
+        generatePieceMoves(board, sq, pieceMoves);
+
+        for (Move m : pieceMoves)
+        {
+            board.makeMove(m);
+            bool legal = !board.kingInCheck(movingColor);
+            board.unMakeMove();
+
+            if (legal)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
 void generatePawnCaptureMoves(const Board &board, const int &sq, MoveList &moves)
@@ -458,6 +509,13 @@ void generateKingCaptureMoves(const Board &board, const int &sq, MoveList &moves
 MoveList generatePseudoLegalCaptureMoves(const Board &board)
 {
     MoveList moves;
+    generatePseudoLegalCaptureMoves(board, moves);
+    return moves;
+}
+
+void generatePseudoLegalCaptureMoves(const Board &board, MoveList &moves)
+{
+    moves.clear();
 
     for (int sq = 0; sq < 64; sq++)
     {
@@ -492,8 +550,6 @@ MoveList generatePseudoLegalCaptureMoves(const Board &board)
             break;
         }
     }
-
-    return moves;
 }
 
 MoveList generateCaptureMoves(Board &board)
@@ -516,26 +572,19 @@ MoveList generateCaptureMoves(Board &board)
     return legalCaptureMoves;
 }
 
+// The evaluation's material values; a king ranks above everything so that
+// MVV-LVA orders king captures after those by other pieces
 int pieceValue(PieceType type)
 {
     switch (type)
     {
-    case PieceType::Pawn:
-        return 100;
-    case PieceType::Knight:
-        return 320;
-    case PieceType::Bishop:
-        return 330;
-    case PieceType::Rook:
-        return 500;
-    case PieceType::Queen:
-        return 900;
-    case PieceType::King:
-        return 20000;
     case PieceType::None:
         return 0;
+    case PieceType::King:
+        return 20000;
+    default:
+        return evalParams().pieceValue[static_cast<int>(type) - 1];
     }
-    return 0;
 }
 
 int scoreMoveStatic(const Move &m, Board &board)
@@ -551,7 +600,7 @@ int scoreMoveStatic(const Move &m, Board &board)
 
     if (m.promotion != PieceType::None)
     {
-        score += 900;
+        score += pieceValue(m.promotion);
     }
 
     return score;
@@ -559,47 +608,29 @@ int scoreMoveStatic(const Move &m, Board &board)
 
 MoveList generateOrderedMoves(Board &board)
 {
-    MoveList pseudoLegalMoves = generatePseudoLegalMoves(board);
-    ScoredMoveList scoredLegalMoves;
-    int moveScore;
-
-    Color movingColor = board.sideToMove();
-
-    for (Move m : pseudoLegalMoves)
-    {
-        board.makeMove(m);
-        if (!board.kingInCheck(movingColor))
-        {
-            moveScore = scoreMoveStatic(m, board);
-            if (board.kingInCheck(oppositeColor(board.sideToMove())))
-            {
-                moveScore += 50;
-            }
-            scoredLegalMoves.push_back({m, moveScore});
-        }
-        board.unMakeMove();
-    }
-
-    std::sort(scoredLegalMoves.begin(), scoredLegalMoves.end(),
-              [](const ScoredMove &a, const ScoredMove &b)
-              { return a.score > b.score; }); // descending
-
-    MoveList orderedMoves;
-    for (ScoredMove m : scoredLegalMoves)
-        orderedMoves.push_back(m.move);
-
-    return orderedMoves;
+    MoveList moves;
+    ScoredMoveList scored;
+    generateOrderedMoves(board, moves, scored);
+    return moves;
 }
 
 MoveList generateOrderedCaptureMoves(Board &board)
 {
-    MoveList pseudoLegalMoves = generatePseudoLegalCaptureMoves(board);
-    ScoredMoveList scoredLegalMoves;
+    MoveList moves;
+    ScoredMoveList scored;
+    generateOrderedCaptureMoves(board, moves, scored);
+    return moves;
+}
+
+// Keeps the legal moves of the list, sorted by static score; scored is scratch space
+static void orderLegalMoves(Board &board, MoveList &moves, ScoredMoveList &scored)
+{
     int moveScore;
+    scored.clear();
 
     Color movingColor = board.sideToMove();
 
-    for (Move m : pseudoLegalMoves)
+    for (const Move &m : moves)
     {
         board.makeMove(m);
         if (!board.kingInCheck(movingColor))
@@ -609,18 +640,28 @@ MoveList generateOrderedCaptureMoves(Board &board)
             {
                 moveScore += 50;
             }
-            scoredLegalMoves.push_back({m, moveScore});
+            scored.push_back({m, moveScore});
         }
         board.unMakeMove();
     }
 
-    std::sort(scoredLegalMoves.begin(), scoredLegalMoves.end(),
+    std::sort(scored.begin(), scored.end(),
               [](const ScoredMove &a, const ScoredMove &b)
               { return a.score > b.score; }); // descending
 
-    MoveList orderedMoves;
-    for (ScoredMove m : scoredLegalMoves)
-        orderedMoves.push_back(m.move);
+    moves.clear();
+    for (const ScoredMove &m : scored)
+        moves.push_back(m.move);
+}
 
-    return orderedMoves;
+void generateOrderedMoves(Board &board, MoveList &moves, ScoredMoveList &scored)
+{
+    generatePseudoLegalMoves(board, moves);
+    orderLegalMoves(board, moves, scored);
 }
+
+void generateOrderedCaptureMoves(Board &board, MoveList &moves, ScoredMoveList &scored)
+{
+    generatePseudoLegalCaptureMoves(board, moves);
+    orderLegalMoves(board, moves, scored);
+}
\ No newline at end of file
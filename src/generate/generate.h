@@ -11,10 +11,19 @@ void generateKnightMoves(const Board &board, const int &sq, MoveList &moves);
 
 void generateKingMoves(const Board &board, const int &sq, MoveList &moves);
 
+void generatePieceMoves(const Board &board, const int &sq, MoveList &moves);
+
 MoveList generatePseudoLegalMoves(const Board &board);
 
 MoveList generateLegalMoves(Board &board);
 
+// The overloads taking a list clear and refill it, reusing its capacity
+void generatePseudoLegalMoves(const Board &board, MoveList &moves);
+
+void generateLegalMoves(Board &board, MoveList &moves);
+
+bool hasLegalMove(Board &board);
+
 void generatePawnCaptureMoves(const Board &board, const int &sq, MoveList &moves);
 
 template <size_t numDirections>
@@ -26,6 +35,8 @@ void generateKingCaptureMoves(const Board &board, const int &sq, MoveList &moves
 
 MoveList generatePseudoLegalCaptureMoves(const Board &board);
 
+void generatePseudoLegalCaptureMoves(const Board &board, MoveList &moves);
+
 MoveList generateCaptureMoves(Board &board);
 
 int pieceValue(PieceType type);
@@ -35,3 +46,7 @@ int scoreMoveStatic(const Move &m, const Board &board);
 MoveList generateOrderedMoves(Board &board);
 
 MoveList generateOrderedCaptureMoves(Board &board);
+
+void generateOrderedMoves(Board &board, MoveList &moves, ScoredMoveList &scored);
+
+void generateOrderedCaptureMoves(Board &board, MoveList &moves, ScoredMoveList &scored);
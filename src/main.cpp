@@ -6,93 +6,25 @@
 #include <sstream>
 #include <cassert>
 #include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include <random>
+#include <chrono>
 
 #include "board/board.h"
 #include "generate/generate.h"
 #include "evaluate/evaluate.h"
+#include "endgame/endgame.h"
 #include "utils/utils.h"
 #include "tests/tests.h"
-
-int fileCharToInt(char f) { return f - 'a'; }
-int rankCharToInt(char r) { return r - '1'; }
-
-int squareFromString(const std::string &s)
-{
-    int file = fileCharToInt(s[0]);
-    int rank = rankCharToInt(s[1]);
-    return rank * 8 + file;
-}
-
-Move parseMove(const std::string &moveStr, const Board &board)
-{
-    if (moveStr.length() < 4)
-        throw std::invalid_argument("Move string too short");
-
-    Move m;
-    m.from = squareFromString(moveStr.substr(0, 2));
-    m.to = squareFromString(moveStr.substr(2, 2));
-    m.type = MoveType::Standard;
-    m.promotion = PieceType::None;
-
-    Piece movingPiece = board.pieceAt(m.from);
-    Piece targetPiece = board.pieceAt(m.to);
-
-    if (moveStr.length() == 5)
-    {
-        char promoChar = moveStr[4];
-        switch (promoChar)
-        {
-        case 'q':
-            m.promotion = PieceType::Queen;
-            break;
-        case 'r':
-            m.promotion = PieceType::Rook;
-            break;
-        case 'b':
-            m.promotion = PieceType::Bishop;
-            break;
-        case 'n':
-            m.promotion = PieceType::Knight;
-            break;
-        default:
-            throw std::invalid_argument("Invalid promotion piece");
-        }
-        m.type = MoveType::Promotion;
-    }
-
-    if (movingPiece.type == PieceType::King)
-    {
-        if (m.from == 4 && m.to == 6)
-            m.type = MoveType::KingCastle;
-        if (m.from == 4 && m.to == 2)
-            m.type = MoveType::QueenCastle;
-    }
-
-    if (targetPiece.type != PieceType::None && targetPiece.color != movingPiece.color)
-    {
-        m.type = MoveType::Capture;
-    }
-
-    if (movingPiece.type == PieceType::Pawn)
-    {
-        int rankFrom = m.from / 8;
-        int rankTo = m.to / 8;
-        if (std::abs(rankTo - rankFrom) == 2)
-            m.type = MoveType::DoublePawnPush;
-    }
-
-    if (movingPiece.type == PieceType::Pawn && targetPiece.type == PieceType::None)
-    {
-        int fileFrom = m.from % 8;
-        int fileTo = m.to % 8;
-        if (std::abs(fileTo - fileFrom) == 1 && m.to == board.enPassantSquare())
-        {
-            m.type = MoveType::EnPassant;
-        }
-    }
-
-    return m;
-}
+#include "uci/uci.h"
+#include "epd/epd.h"
+#include "match/match.h"
+#include "book/book.h"
+#include "pgn/pgn.h"
+#include "notation/notation.h"
+#include "datagen/datagen.h"
+#include "tuner/tuner.h"
 
 // 56 57 58 59 60 61 62 63
 // 48 49 50 51 52 53 54 55
@@ -112,18 +44,60 @@ Move parseMove(const std::string &moveStr, const Board &board)
 // a2 b2 c2 d2 e2 f2 g2 h2
 // a1 b1 c1 d1 e1 f1 g1 h1
 
-int main()
+void playInteractive(int argc, char *argv[])
 {
+    OpeningBook book;
+    std::string bookPath;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "-book")
+            bookPath = argv[i + 1];
+    }
+    if (!bookPath.empty())
+    {
+        book.open(bookPath);
+    }
+    std::mt19937_64 bookRng(std::random_device{}());
 
     Board board = Board();
     //board.setFEN("8/3b4/8/4k3/8/5P2/1PP4P/2B4K w - - 0 63");
     std::cout << board.print();
     //perft(board, 5, true);
 
+    SearchLimits limits;
+    limits.moveTime = 5000;
+    TimeManager timeManager;
+    SearchResult result;
+    std::thread ponderThread;
+    Move expectedReply;
+    bool pondering = false;
+
     while (!gameOver(board))
     {
-        Move bestMove = findBestMove(board, 10, 5.0);
-        board.makeMove(bestMove);
+        Move bookMove;
+        if (pondering)
+        {
+            // ponderhit already turned the background search into a timed one
+            ponderThread.join();
+            pondering = false;
+        }
+        else if (book.isOpen() && book.probe(board, bookMove, BookSelection::Weighted, bookRng))
+        {
+            timeManager.start(0);
+            result = SearchResult();
+            result.bestMove = bookMove;
+            result.pv.assign(1, bookMove);
+        }
+        else
+        {
+            timeManager.start(limits, board.sideToMove());
+            result = searchPosition(board, 10, timeManager);
+        }
+
+        std::cout << result.nodes << " nodes (depth " << result.depth << (result.partial ? "+" : "") << ", " << timeManager.elapsed() << " seconds)\n";
+        std::cout << moveToSan(board, result.bestMove) << std::endl;
+        board.makeMove(result.bestMove);
         std::cout << board.print();
 
         if (gameOver(board))
@@ -131,16 +105,65 @@ int main()
             break;
         }
 
+        // Think on the user's time, assuming they play the expected reply
+        if (result.pv.size() >= 2)
+        {
+            expectedReply = result.pv[1];
+            Board ponderBoard = board;
+            ponderBoard.makeMove(expectedReply);
+
+            SearchLimits ponderLimits = limits;
+            ponderLimits.ponder = true;
+            timeManager.start(ponderLimits, ponderBoard.sideToMove());
+            pondering = true;
+            ponderThread = std::thread([&result, &timeManager, ponderBoard]() mutable
+                                       { result = searchPosition(ponderBoard, 10, timeManager); });
+        }
+
+        // SAN, LAN or coordinates, asked again until legal
+        Move m;
         std::string userMove;
-        std::cin >> userMove;
+        while (std::cin >> userMove)
+        {
+            try
+            {
+                m = parseMove(board, userMove);
+                break;
+            }
+            catch (const std::invalid_argument &e)
+            {
+                std::cout << e.what() << std::endl;
+            }
+        }
+        if (!std::cin)
+        {
+            break;
+        }
+
+        if (pondering && m != expectedReply)
+        {
+            timeManager.stop = true;
+            ponderThread.join();
+            pondering = false;
+        }
+        else if (pondering)
+        {
+            timeManager.ponderHit();
+        }
 
-        Move m = parseMove(userMove, board);
         board.makeMove(m);
         std::cout << board.print();
     }
 
-    if (board.kingInCheck())
+    if (ponderThread.joinable())
     {
+        timeManager.stop = true;
+        ponderThread.join();
+    }
+
+    switch (gameStatus(board))
+    {
+    case GameStatus::Checkmate:
         if (board.sideToMove() == Color::Black)
         {
             std::cout << "White wins by checkmate";
@@ -149,11 +172,241 @@ int main()
         {
             std::cout << "Black wins by checkmate";
         }
+        break;
+    case GameStatus::Stalemate:
+        std::cout << "Stalemate";
+        break;
+    case GameStatus::FiftyMoveRule:
+        std::cout << "Draw by the fifty-move rule";
+        break;
+    case GameStatus::ThreefoldRepetition:
+        std::cout << "Draw by threefold repetition";
+        break;
+    case GameStatus::Ongoing:
+        break;
     }
-    else
+}
+
+// chess_engine epd <file> [-t seconds] [-n nodes] [-j threads]
+void runEpd(int argc, char *argv[])
+{
+    if (argc < 3)
     {
-        std::cout << "Stalemate";
+        throw std::invalid_argument("usage: epd <file> [-t seconds] [-n nodes] [-j threads]");
+    }
+
+    double timeLimit = 1.0;
+    bool timeGiven = false;
+    uint64_t nodeLimit = 0;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "-t")
+        {
+            timeLimit = std::stod(argv[i + 1]);
+            timeGiven = true;
+        }
+        else if (flag == "-n")
+            nodeLimit = std::stoull(argv[i + 1]);
+        else if (flag == "-j")
+            threads = std::stoi(argv[i + 1]);
+    }
+
+    // a node limit alone means no time limit
+    if (nodeLimit > 0 && !timeGiven)
+    {
+        timeLimit = 0;
+    }
+
+    std::vector<EpdPosition> positions = loadEpd(argv[2]);
+    std::vector<EpdResult> results = runEpdSuite(positions, timeLimit, nodeLimit, threads);
+    printEpdReport(positions, results);
+}
+
+// chess_engine match [-games N] [-j threads] [-tc seconds+increment] [-nodes N] [-openings file]
+//                    [-elo0 x] [-elo1 y] [-A option=value] [-B option=value]
+void runSelfPlayMatch(int argc, char *argv[])
+{
+    EngineConfig first{"A", SearchOptions()};
+    EngineConfig second{"B", SearchOptions()};
+    MatchSettings settings;
+    settings.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+
+        if (flag == "-games")
+            settings.games = std::stoi(value);
+        else if (flag == "-j")
+            settings.threads = std::stoi(value);
+        else if (flag == "-tc")
+        {
+            size_t plus = value.find('+');
+            settings.baseTime = static_cast<int>(std::stod(value.substr(0, plus)) * 1000);
+            settings.increment = (plus == std::string::npos) ? 0 : static_cast<int>(std::stod(value.substr(plus + 1)) * 1000);
+        }
+        else if (flag == "-nodes")
+            settings.nodes = std::stoull(value);
+        else if (flag == "-openings")
+            settings.openings = loadOpenings(value);
+        else if (flag == "-elo0")
+            settings.elo0 = std::stod(value);
+        else if (flag == "-elo1")
+            settings.elo1 = std::stod(value);
+        else if ((flag == "-A" && !applyOption(first.options, value)) || (flag == "-B" && !applyOption(second.options, value)))
+            throw std::invalid_argument("Unknown search option: " + value);
+    }
+
+    runMatch(first, second, settings);
+}
+
+// chess_engine datagen [-o file] [-append] [-eval params.txt] [-positions N] [-nodes N] [-j threads] [-random plies] [-seed N]
+void runDatagen(int argc, char *argv[])
+{
+    DatagenSettings settings;
+    settings.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "-append")
+        {
+            settings.append = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            throw std::invalid_argument("Missing value for datagen flag: " + flag);
+        std::string value = argv[++i];
+
+        if (flag == "-o")
+            settings.output = value;
+        else if (flag == "-eval")
+            setEvalParams(loadEvalParams(value));
+        else if (flag == "-positions")
+            settings.positions = std::stoull(value);
+        else if (flag == "-nodes")
+            settings.nodes = std::stoull(value);
+        else if (flag == "-j")
+            settings.threads = std::stoi(value);
+        else if (flag == "-random")
+            settings.randomPlies = std::stoi(value);
+        else if (flag == "-seed")
+            settings.seed = std::stoull(value);
+        else
+            throw std::invalid_argument("Unknown datagen flag: " + flag);
+    }
+
+    generateTrainingData(settings);
+}
+
+// chess_engine tune -data file [-data file ...] [-eval start.txt] [-o tuned.txt] [-epochs N] [-lr x] [-lambda x] [-k x] [-j threads]
+void runTuning(int argc, char *argv[])
+{
+    TunerSettings settings;
+    settings.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+
+        if (flag == "-data")
+            settings.inputs.push_back(value);
+        else if (flag == "-eval")
+            setEvalParams(loadEvalParams(value));
+        else if (flag == "-o")
+            settings.output = value;
+        else if (flag == "-epochs")
+            settings.epochs = std::stoi(value);
+        else if (flag == "-lr")
+            settings.learningRate = std::stod(value);
+        else if (flag == "-lambda")
+            settings.lambda = std::stod(value);
+        else if (flag == "-k")
+            settings.scale = std::stod(value);
+        else if (flag == "-j")
+            settings.threads = std::stoi(value);
+        else
+            throw std::invalid_argument("Unknown tune flag: " + flag);
+    }
+
+    runTuner(settings);
+}
+
+// chess_engine pgn <file>: replays every game and reports the totals
+void runPgn(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        throw std::invalid_argument("usage: pgn <file>");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PgnReader reader(argv[2]);
+    PgnGame game;
+    Board board;
+    size_t plies = 0;
+    size_t errors = 0;
+
+    while (true)
+    {
+        try
+        {
+            if (!reader.next(game, board))
+                break;
+            plies += game.moves.size();
+        }
+        catch (const std::runtime_error &e)
+        {
+            errors++;
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << reader.gamesRead() << " games, " << plies << " plies, " << errors << " errors in " << seconds << " s" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode = (argc > 1) ? argv[1] : "";
+    initKPK();
+
+    if (mode == "play")
+    {
+        playInteractive(argc, argv);
+        return 0;
+    }
+    if (mode == "epd")
+    {
+        runEpd(argc, argv);
+        return 0;
+    }
+    if (mode == "match")
+    {
+        runSelfPlayMatch(argc, argv);
+        return 0;
+    }
+    if (mode == "datagen")
+    {
+        runDatagen(argc, argv);
+        return 0;
+    }
+    if (mode == "tune")
+    {
+        runTuning(argc, argv);
+        return 0;
+    }
+    if (mode == "pgn")
+    {
+        runPgn(argc, argv);
+        return 0;
     }
 
+    uciLoop();
     return 0;
 }
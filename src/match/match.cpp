@@ -0,0 +1,282 @@
+#include "match.h"
+#include "uci/uci.h"
+#include "timeman/timeman.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+static const char *const startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+enum struct GameOutcome
+{
+    WhiteWins,
+    Draw,
+    BlackWins
+};
+
+std::vector<Opening> defaultOpenings()
+{
+    const char *const lines[] = {
+        "e2e4 c7c5",
+        "e2e4 e7e6",
+        "e2e4 c7c6",
+        "e2e4 e7e5 g1f3 b8c6 f1b5",
+        "e2e4 e7e5 g1f3 b8c6 f1c4",
+        "d2d4 d7d5 c2c4 e7e6",
+        "d2d4 g8f6 c2c4 g7g6",
+        "c2c4 e7e5",
+    };
+
+    std::vector<Opening> openings;
+    for (const char *line : lines)
+    {
+        Opening opening;
+        opening.fen = startFEN;
+        std::istringstream iss(line);
+        std::string move;
+        while (iss >> move)
+        {
+            opening.moves.push_back(move);
+        }
+        openings.push_back(opening);
+    }
+    return openings;
+}
+
+// One position per line, as a full FEN or as the four EPD fields
+std::vector<Opening> loadOpenings(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open opening file: " + path);
+    }
+
+    std::vector<Opening> openings;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        std::string placement, side, castling, enPassant, halfMove, fullMove;
+        if (!(iss >> placement >> side >> castling >> enPassant))
+        {
+            continue;
+        }
+        if (!(iss >> halfMove >> fullMove) || halfMove.find_first_not_of("0123456789") != std::string::npos)
+        {
+            halfMove = "0";
+            fullMove = "1";
+        }
+
+        Opening opening;
+        opening.fen = placement + " " + side + " " + castling + " " + enPassant + " " + halfMove + " " + fullMove;
+        openings.push_back(opening);
+    }
+    return openings;
+}
+
+bool applyOption(SearchOptions &options, const std::string &assignment)
+{
+    size_t equals = assignment.find('=');
+    if (equals == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string key = assignment.substr(0, equals);
+    int value = std::stoi(assignment.substr(equals + 1));
+
+    if (key == "check")
+        options.checkExtensions = value != 0;
+    else if (key == "singular")
+        options.singularExtensions = value != 0;
+    else if (key == "extensions")
+        options.maxExtensions = value;
+    else if (key == "singulardepth")
+        options.singularMinDepth = value;
+    else
+        return false;
+    return true;
+}
+
+// Log-likelihood ratio of elo1 against elo0 under the normal approximation
+// of the game score, the same test fishtest-style frameworks use
+double sprtLLR(int wins, int draws, int losses, double elo0, double elo1)
+{
+    double games = wins + draws + losses;
+    if (games == 0)
+    {
+        return 0;
+    }
+
+    double score = (wins + 0.5 * draws) / games;
+    double variance = (wins * std::pow(1 - score, 2) + draws * std::pow(0.5 - score, 2) + losses * std::pow(score, 2)) / games;
+    if (variance <= 0)
+    {
+        return 0;
+    }
+
+    double score0 = 1 / (1 + std::pow(10, -elo0 / 400));
+    double score1 = 1 / (1 + std::pow(10, -elo1 / 400));
+    return (score1 - score0) * (2 * score - score0 - score1) / (2 * variance / games);
+}
+
+static GameOutcome playGame(const EngineConfig &white, const EngineConfig &black, const Opening &opening, const MatchSettings &settings,
+                            TranspositionTable &whiteTable, TranspositionTable &blackTable)
+{
+    Board board;
+    board.setFEN(opening.fen);
+    for (const std::string &move : opening.moves)
+    {
+        board.makeMove(uciToMove(board, move));
+    }
+
+    whiteTable.clear();
+    blackTable.clear();
+
+    SearchOptions whiteOptions = white.options;
+    SearchOptions blackOptions = black.options;
+    whiteOptions.table = &whiteTable;
+    blackOptions.table = &blackTable;
+
+    int clocks[2] = {settings.baseTime, settings.baseTime};
+
+    for (int ply = 0; ply < settings.maxPlies; ply++)
+    {
+        switch (gameStatus(board))
+        {
+        case GameStatus::Ongoing:
+            break;
+        case GameStatus::Checkmate:
+            return (board.sideToMove() == Color::White) ? GameOutcome::BlackWins : GameOutcome::WhiteWins;
+        default:
+            return GameOutcome::Draw;
+        }
+
+        Color side = board.sideToMove();
+        size_t index = (side == Color::White) ? 0 : 1;
+
+        SearchLimits limits;
+        if (settings.nodes > 0)
+        {
+            limits.nodes = settings.nodes;
+        }
+        else
+        {
+            limits.whiteTime = clocks[0];
+            limits.blackTime = clocks[1];
+            limits.whiteIncrement = settings.increment;
+            limits.blackIncrement = settings.increment;
+        }
+
+        TimeManager timeManager;
+        timeManager.start(limits, side);
+        SearchResult result = searchPosition(board, maxSearchPly - 1, timeManager, nullptr, (side == Color::White) ? whiteOptions : blackOptions);
+
+        if (settings.nodes == 0)
+        {
+            clocks[index] -= static_cast<int>(timeManager.elapsed() * 1000);
+            if (clocks[index] < 0)
+            {
+                return (side == Color::White) ? GameOutcome::BlackWins : GameOutcome::WhiteWins;
+            }
+            clocks[index] += settings.increment;
+        }
+
+        board.makeMove(result.bestMove);
+    }
+
+    return GameOutcome::Draw;
+}
+
+// Games are played in pairs from each opening with colours reversed. Every
+// thread owns a hash table per engine so the two configurations never share entries.
+MatchResult runMatch(const EngineConfig &first, const EngineConfig &second, const MatchSettings &settings)
+{
+    std::vector<Opening> openings = settings.openings.empty() ? defaultOpenings() : settings.openings;
+
+    MatchResult result;
+    result.lowerBound = std::log(settings.beta / (1 - settings.alpha));
+    result.upperBound = std::log((1 - settings.beta) / settings.alpha);
+
+    std::mutex resultMutex;
+    std::atomic<int> nextGame(0);
+    std::atomic<bool> finished(false);
+    std::vector<std::thread> pool;
+
+    for (int t = 0; t < std::max(1, settings.threads); t++)
+    {
+        pool.emplace_back([&]()
+                          {
+            TranspositionTable firstTable(settings.hashMB);
+            TranspositionTable secondTable(settings.hashMB);
+
+            for (int game = nextGame++; game < settings.games && !finished; game = nextGame++)
+            {
+                const Opening &opening = openings[static_cast<size_t>(game / 2) % openings.size()];
+                bool firstIsWhite = game % 2 == 0;
+
+                GameOutcome outcome;
+                try
+                {
+                    outcome = firstIsWhite ? playGame(first, second, opening, settings, firstTable, secondTable)
+                                           : playGame(second, first, opening, settings, secondTable, firstTable);
+                }
+                catch (const std::exception &e)
+                {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    std::cout << "Game " << game << " skipped: " << e.what() << std::endl;
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (outcome == GameOutcome::Draw)
+                    result.draws++;
+                else if ((outcome == GameOutcome::WhiteWins) == firstIsWhite)
+                    result.wins++;
+                else
+                    result.losses++;
+
+                result.llr = sprtLLR(result.wins, result.draws, result.losses, settings.elo0, settings.elo1);
+                if (result.llr <= result.lowerBound || result.llr >= result.upperBound)
+                {
+                    finished = true;
+                }
+
+                std::cout << "Games " << (result.wins + result.draws + result.losses) << ": +" << result.wins << " =" << result.draws << " -" << result.losses
+                          << std::fixed << std::setprecision(2) << " LLR " << result.llr << " [" << result.lowerBound << ", " << result.upperBound << "]" << std::endl;
+            } });
+    }
+
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+
+    int games = result.wins + result.draws + result.losses;
+    if (games > 0)
+    {
+        double score = (result.wins + 0.5 * result.draws) / games;
+        std::cout << first.name << " vs " << second.name << ": score " << std::setprecision(1) << score * 100 << "%";
+        if (score > 0 && score < 1)
+        {
+            std::cout << ", elo " << -400 * std::log10(1 / score - 1);
+        }
+        std::cout << "\n";
+    }
+
+    if (result.llr >= result.upperBound)
+        std::cout << "SPRT: H1 accepted (elo " << settings.elo1 << ")" << std::endl;
+    else if (result.llr <= result.lowerBound)
+        std::cout << "SPRT: H0 accepted (elo " << settings.elo0 << ")" << std::endl;
+    else
+        std::cout << "SPRT: inconclusive" << std::endl;
+
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "board/board.h"
+#include "evaluate/evaluate.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct EngineConfig
+{
+    std::string name;
+    SearchOptions options;
+};
+
+struct Opening
+{
+    std::string fen;
+    std::vector<std::string> moves; // UCI moves played from fen
+};
+
+struct MatchSettings
+{
+    int games = 1000;
+    int threads = 1;
+    int baseTime = 10000; // milliseconds per side
+    int increment = 100;  // milliseconds per move
+    uint64_t nodes = 0;   // fixed nodes per move instead of a clock when non-zero
+    int maxPlies = 400;   // adjudicated as a draw beyond this
+    size_t hashMB = 16;   // per engine per game thread
+    std::vector<Opening> openings;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+struct MatchResult
+{
+    int wins = 0; // counted for the first engine
+    int draws = 0;
+    int losses = 0;
+    double llr = 0;
+    double lowerBound = 0;
+    double upperBound = 0;
+};
+
+std::vector<Opening> defaultOpenings();
+
+std::vector<Opening> loadOpenings(const std::string &path);
+
+bool applyOption(SearchOptions &options, const std::string &assignment);
+
+double sprtLLR(int wins, int draws, int losses, double elo0, double elo1);
+
+MatchResult runMatch(const EngineConfig &first, const EngineConfig &second, const MatchSettings &settings);
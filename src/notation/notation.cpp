@@ -0,0 +1,383 @@
+#include "notation.h"
+#include "generate/generate.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <cstring>
+
+static PieceType pieceFromChar(char c)
+{
+    switch (c)
+    {
+    case 'N':
+        return PieceType::Knight;
+    case 'B':
+        return PieceType::Bishop;
+    case 'R':
+        return PieceType::Rook;
+    case 'Q':
+        return PieceType::Queen;
+    case 'K':
+        return PieceType::King;
+    default:
+        return PieceType::None;
+    }
+}
+
+// Pseudo-legal moves of one piece type; legality is only checked for the few that match
+static void pieceMoves(const Board &board, PieceType piece, MoveList &moves)
+{
+    moves.clear();
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = board.pieceAt(sq);
+        if (p.type == piece && p.color == board.sideToMove())
+            generatePieceMoves(board, sq, moves);
+    }
+}
+
+static bool isLegal(Board &board, const Move &m)
+{
+    Color movingColor = board.sideToMove();
+    board.makeMove(m);
+    bool legal = !board.kingInCheck(movingColor);
+    board.unMakeMove();
+    return legal;
+}
+
+// Resolves a SAN move by matching it against the legal moves, so
+// disambiguation only has to be as precise as the position requires.
+Move sanToMove(Board &board, const std::string &san)
+{
+    std::string text = san;
+    while (!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' || text.back() == '?'))
+    {
+        text.pop_back();
+    }
+
+    thread_local MoveList candidates;
+
+    if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0")
+    {
+        MoveType castle = (text.size() == 3) ? MoveType::KingCastle : MoveType::QueenCastle;
+        pieceMoves(board, PieceType::King, candidates);
+        for (const Move &m : candidates)
+        {
+            if (m.type == castle && isLegal(board, m))
+            {
+                return m;
+            }
+        }
+        throw std::invalid_argument("Illegal castling move: " + san);
+    }
+
+    PieceType promotion = PieceType::None;
+    size_t equals = text.find('=');
+    if (equals != std::string::npos && equals + 1 < text.size())
+    {
+        promotion = pieceFromChar(static_cast<char>(std::toupper(static_cast<unsigned char>(text[equals + 1]))));
+        text.erase(equals);
+    }
+    else if (text.size() > 2 && pieceFromChar(text.back()) != PieceType::None && text.back() != 'K')
+    {
+        promotion = pieceFromChar(text.back());
+        text.pop_back();
+    }
+
+    if (text.size() < 2)
+    {
+        throw std::invalid_argument("Malformed SAN move: " + san);
+    }
+
+    PieceType piece = pieceFromChar(text[0]);
+    size_t start = 0;
+    if (piece == PieceType::None)
+    {
+        piece = PieceType::Pawn;
+    }
+    else
+    {
+        start = 1;
+    }
+
+    char toFile = text[text.size() - 2];
+    char toRank = text[text.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8')
+    {
+        throw std::invalid_argument("Malformed SAN move: " + san);
+    }
+    int to = (toRank - '1') * 8 + (toFile - 'a');
+
+    int fromFile = -1;
+    int fromRank = -1;
+    for (size_t i = start; i + 2 < text.size(); i++)
+    {
+        if (text[i] >= 'a' && text[i] <= 'h')
+            fromFile = text[i] - 'a';
+        else if (text[i] >= '1' && text[i] <= '8')
+            fromRank = text[i] - '1';
+    }
+
+    Move found;
+    int matches = 0;
+    pieceMoves(board, piece, candidates);
+    for (const Move &m : candidates)
+    {
+        if (m.to != to || m.promotion != promotion)
+            continue;
+        if (fromFile != -1 && m.from % 8 != fromFile)
+            continue;
+        if (fromRank != -1 && m.from / 8 != fromRank)
+            continue;
+        if (!isLegal(board, m))
+            continue;
+
+        found = m;
+        matches++;
+    }
+
+    if (matches == 0)
+    {
+        throw std::invalid_argument("Illegal move: " + san);
+    }
+    if (matches > 1)
+    {
+        throw std::invalid_argument("Ambiguous move: " + san);
+    }
+    return found;
+}
+
+
+static char pieceLetter(PieceType type)
+{
+    switch (type)
+    {
+    case PieceType::Knight:
+        return 'N';
+    case PieceType::Bishop:
+        return 'B';
+    case PieceType::Rook:
+        return 'R';
+    case PieceType::Queen:
+        return 'Q';
+    case PieceType::King:
+        return 'K';
+    default:
+        return '?';
+    }
+}
+
+static char *writeSquare(int sq, char *out)
+{
+    *out++ = static_cast<char>('a' + sq % 8);
+    *out++ = static_cast<char>('1' + sq / 8);
+    return out;
+}
+
+static bool isCastle(const Move &move)
+{
+    return move.type == MoveType::KingCastle || move.type == MoveType::QueenCastle;
+}
+
+// "+" or "#" when the move gives check
+static char *writeCheck(Board &board, const Move &move, char *out)
+{
+    board.makeMove(move);
+    if (board.kingInCheck())
+    {
+        *out++ = hasLegalMove(board) ? '+' : '#';
+    }
+    board.unMakeMove();
+    return out;
+}
+
+static size_t finish(char *buffer, char *out)
+{
+    *out = '\0';
+    return static_cast<size_t>(out - buffer);
+}
+
+size_t writeUci(const Move &move, char *buffer)
+{
+    char *out = writeSquare(move.from, buffer);
+    out = writeSquare(move.to, out);
+    if (move.promotion != PieceType::None)
+    {
+        *out++ = static_cast<char>(std::tolower(pieceLetter(move.promotion)));
+    }
+    return finish(buffer, out);
+}
+
+size_t writeSan(Board &board, const Move &move, char *buffer)
+{
+    char *out = buffer;
+    PieceType piece = board.pieceAt(move.from).type;
+    bool capture = board.pieceAt(move.to).type != PieceType::None || move.type == MoveType::EnPassant;
+
+    if (isCastle(move))
+    {
+        const char *castle = (move.type == MoveType::KingCastle) ? "O-O" : "O-O-O";
+        out = std::copy(castle, castle + std::strlen(castle), out);
+    }
+    else if (piece == PieceType::Pawn)
+    {
+        if (capture)
+        {
+            *out++ = static_cast<char>('a' + move.from % 8);
+            *out++ = 'x';
+        }
+        out = writeSquare(move.to, out);
+        if (move.promotion != PieceType::None)
+        {
+            *out++ = '=';
+            *out++ = pieceLetter(move.promotion);
+        }
+    }
+    else
+    {
+        *out++ = pieceLetter(piece);
+
+        // another piece of the same kind reaching the same square needs the from file,
+        // or the rank if they share the file, or both
+        thread_local MoveList candidates;
+        pieceMoves(board, piece, candidates);
+        bool ambiguous = false;
+        bool sameFile = false;
+        bool sameRank = false;
+        for (const Move &m : candidates)
+        {
+            if (m.to != move.to || m.from == move.from || !isLegal(board, m))
+                continue;
+            ambiguous = true;
+            sameFile = sameFile || m.from % 8 == move.from % 8;
+            sameRank = sameRank || m.from / 8 == move.from / 8;
+        }
+        if (ambiguous && (!sameFile || sameRank))
+            *out++ = static_cast<char>('a' + move.from % 8);
+        if (ambiguous && sameFile)
+            *out++ = static_cast<char>('1' + move.from / 8);
+
+        if (capture)
+            *out++ = 'x';
+        out = writeSquare(move.to, out);
+    }
+
+    return finish(buffer, writeCheck(board, move, out));
+}
+
+size_t writeLan(Board &board, const Move &move, char *buffer)
+{
+    if (isCastle(move))
+    {
+        return writeSan(board, move, buffer);
+    }
+
+    char *out = buffer;
+    PieceType piece = board.pieceAt(move.from).type;
+    if (piece != PieceType::Pawn)
+    {
+        *out++ = pieceLetter(piece);
+    }
+    out = writeSquare(move.from, out);
+    *out++ = (board.pieceAt(move.to).type != PieceType::None || move.type == MoveType::EnPassant) ? 'x' : '-';
+    out = writeSquare(move.to, out);
+    if (move.promotion != PieceType::None)
+    {
+        *out++ = '=';
+        *out++ = pieceLetter(move.promotion);
+    }
+    return finish(buffer, writeCheck(board, move, out));
+}
+
+std::string moveToUci(const Move &move)
+{
+    char text[moveTextSize];
+    return std::string(text, writeUci(move, text));
+}
+
+std::string moveToSan(Board &board, const Move &move)
+{
+    char text[moveTextSize];
+    return std::string(text, writeSan(board, move, text));
+}
+
+std::string moveToLan(Board &board, const Move &move)
+{
+    char text[moveTextSize];
+    return std::string(text, writeLan(board, move, text));
+}
+
+bool findMove(Board &board, int from, int to, PieceType promotion, Move &move)
+{
+    if (from < 0 || from > 63 || to < 0 || to > 63 || board.pieceAt(from).color != board.sideToMove())
+    {
+        return false;
+    }
+
+    thread_local MoveList candidates;
+    candidates.clear();
+    generatePieceMoves(board, from, candidates);
+    for (const Move &m : candidates)
+    {
+        if (m.to == to && m.promotion == promotion && isLegal(board, m))
+        {
+            move = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isFile(char c)
+{
+    return c >= 'a' && c <= 'h';
+}
+
+static bool isRank(char c)
+{
+    return c >= '1' && c <= '8';
+}
+
+static int squareAt(std::string_view text, size_t i)
+{
+    return (text[i + 1] - '1') * 8 + (text[i] - 'a');
+}
+
+Move parseMove(Board &board, std::string_view text)
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    while (!text.empty() && (std::isspace(static_cast<unsigned char>(text.back())) || std::strchr("+#!?", text.back()) != nullptr))
+        text.remove_suffix(1);
+
+    // UCI and LAN both spell out the from square, so the move is one lookup
+    size_t start = (!text.empty() && pieceFromChar(text[0]) != PieceType::None) ? 1 : 0;
+    size_t to = start + 2;
+    bool lan = text.size() >= start + 5 && (text[to] == '-' || text[to] == 'x');
+    to += lan ? 1 : 0;
+
+    if (text.size() >= to + 2 && isFile(text[start]) && isRank(text[start + 1]) && isFile(text[to]) && isRank(text[to + 1]))
+    {
+        std::string_view rest = text.substr(to + 2);
+        if (!rest.empty() && rest[0] == '=')
+            rest.remove_prefix(1);
+
+        PieceType promotion = PieceType::None;
+        if (rest.size() == 1)
+            promotion = pieceFromChar(static_cast<char>(std::toupper(static_cast<unsigned char>(rest[0]))));
+
+        if (rest.size() <= 1 && (rest.empty() || (promotion != PieceType::None && promotion != PieceType::King)))
+        {
+            int from = squareAt(text, start);
+            Move move;
+            bool pieceMatches = start == 0 || board.pieceAt(from).type == pieceFromChar(text[0]);
+            if (pieceMatches && findMove(board, from, squareAt(text, to), promotion, move))
+            {
+                return move;
+            }
+            throw std::invalid_argument("Illegal move: " + std::string(text));
+        }
+    }
+
+    return sanToMove(board, std::string(text));
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "board/board.h"
+#include <string>
+#include <string_view>
+
+// Room for the longest move text any formatter writes, with its NUL
+const size_t moveTextSize = 16;
+
+// The formatters write NUL-terminated text into a moveTextSize buffer and return its length
+
+size_t writeUci(const Move &move, char *buffer);
+
+// SAN with the minimal disambiguation and a check or mate suffix, e.g. "Nbd7", "exd6", "e8=Q#"
+size_t writeSan(Board &board, const Move &move, char *buffer);
+
+// Long algebraic, e.g. "Ng1-f3", "e4xd5", "e7-e8=Q+"
+size_t writeLan(Board &board, const Move &move, char *buffer);
+
+std::string moveToUci(const Move &move);
+
+std::string moveToSan(Board &board, const Move &move);
+
+std::string moveToLan(Board &board, const Move &move);
+
+// The legal move between two squares, looked up among the moves of the piece on from
+bool findMove(Board &board, int from, int to, PieceType promotion, Move &move);
+
+Move sanToMove(Board &board, const std::string &san);
+
+// Accepts UCI (e2e4, e7e8q), LAN (Ng1-f3, e4xd5) or SAN; throws std::invalid_argument
+// when the text is malformed or the move is not legal
+Move parseMove(Board &board, std::string_view text);
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "packed.h"
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t writerBufferRecords = 4096;
+
+PackedPosition packPosition(const Board &board)
+{
+    PackedPosition packed{};
+    int count = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = board.pieceAt(sq);
+        if (p.type == PieceType::None)
+            continue;
+        if (count == 32)
+        {
+            throw std::runtime_error("more than 32 pieces do not pack");
+        }
+
+        uint8_t code = static_cast<uint8_t>(static_cast<int>(p.type) - 1 + (p.color == Color::Black ? 6 : 0));
+        packed.occupancy |= 1ULL << sq;
+        packed.pieces[count / 2] |= static_cast<uint8_t>(code << (4 * (count % 2)));
+        count++;
+    }
+
+    CastlingAllowed castling = board.castlingAllowed();
+    packed.flags = static_cast<uint8_t>((board.sideToMove() == Color::Black ? 1 : 0) | (castling.whiteKingSide ? 2 : 0) |
+                                        (castling.whiteQueenSide ? 4 : 0) | (castling.blackKingSide ? 8 : 0) |
+                                        (castling.blackQueenSide ? 16 : 0));
+    packed.enPassant = static_cast<uint8_t>(board.enPassantSquare() < 0 ? 0xFF : board.enPassantSquare());
+    packed.halfMoveClock = static_cast<uint8_t>(std::min(board.halfMoveCounter(), 255));
+    packed.fullMoveNumber = static_cast<uint16_t>(std::clamp(board.fullMoveNumber(), 1, 0xFFFF));
+    return packed;
+}
+
+void decodePosition(const PackedPosition &packed, BoardArray &squares, GameState &state)
+{
+    static const PieceType types[] = {PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen, PieceType::King};
+
+    squares.fill(Piece{PieceType::None, Color::None});
+    uint64_t occupied = packed.occupancy;
+    for (int count = 0; occupied != 0; count++)
+    {
+        if (count == 32)
+        {
+            throw std::runtime_error("corrupt packed position: more than 32 pieces");
+        }
+        int sq = __builtin_ctzll(occupied);
+        occupied &= occupied - 1;
+
+        int code = (packed.pieces[count / 2] >> (4 * (count % 2))) & 0xF;
+        if (code >= 12)
+        {
+            throw std::runtime_error("corrupt packed position: bad piece code");
+        }
+        squares[static_cast<size_t>(sq)] = Piece{types[code % 6], code < 6 ? Color::White : Color::Black};
+    }
+
+    state = GameState{};
+    state.sideToMove = (packed.flags & 1) ? Color::Black : Color::White;
+    state.castling = CastlingAllowed{(packed.flags & 2) != 0, (packed.flags & 4) != 0, (packed.flags & 8) != 0, (packed.flags & 16) != 0};
+    state.enPassantSquare = (packed.enPassant == 0xFF) ? -1 : packed.enPassant;
+    state.halfMoveClock = packed.halfMoveClock;
+    state.fullMoveNumber = packed.fullMoveNumber;
+
+    FenError error = validatePosition(squares, state);
+    if (error != FenError::None)
+    {
+        throw std::runtime_error(std::string("corrupt packed position: ") + toString(error));
+    }
+}
+
+void unpackPosition(const PackedPosition &packed, Board &board)
+{
+    BoardArray squares;
+    GameState state;
+    decodePosition(packed, squares, state);
+    board.setPosition(squares, state);
+}
+
+PackedWriter::PackedWriter(const std::string &path, bool append)
+    : file(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc)), buffer(), written(0)
+{
+    if (!file)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+    buffer.reserve(writerBufferRecords);
+}
+
+PackedWriter::~PackedWriter()
+{
+    flush();
+}
+
+void PackedWriter::write(const PackedPosition &packed)
+{
+    buffer.push_back(packed);
+    written++;
+    if (buffer.size() == writerBufferRecords)
+    {
+        flush();
+    }
+}
+
+void PackedWriter::write(const Board &board)
+{
+    write(packPosition(board));
+}
+
+void PackedWriter::flush()
+{
+    if (!buffer.empty())
+    {
+        file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(PackedPosition)));
+        buffer.clear();
+    }
+    file.flush();
+}
+
+size_t PackedWriter::count() const
+{
+    return written;
+}
+
+PackedReader::PackedReader() : records(nullptr), mappedSize(0), recordCount(0), cursor(0)
+{
+}
+
+PackedReader::PackedReader(const std::string &path) : PackedReader()
+{
+    open(path);
+}
+
+PackedReader::~PackedReader()
+{
+    close();
+}
+
+void PackedReader::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size % static_cast<off_t>(sizeof(PackedPosition)) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a packed position file");
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size > 0)
+    {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        records = static_cast<const PackedPosition *>(mapped);
+        mappedSize = size;
+        recordCount = size / sizeof(PackedPosition);
+    }
+    ::close(fd);
+}
+
+void PackedReader::close()
+{
+    if (records != nullptr)
+    {
+        munmap(const_cast<PackedPosition *>(records), mappedSize);
+    }
+    records = nullptr;
+    mappedSize = 0;
+    recordCount = 0;
+    cursor = 0;
+}
+
+size_t PackedReader::size() const
+{
+    return recordCount;
+}
+
+const PackedPosition &PackedReader::operator[](size_t index) const
+{
+    if (index >= recordCount)
+    {
+        throw std::out_of_range("packed position index out of range");
+    }
+    return records[index];
+}
+
+bool PackedReader::next(PackedPosition &packed)
+{
+    if (cursor >= recordCount)
+    {
+        return false;
+    }
+    packed = records[cursor++];
+    return true;
+}
+
+void PackedReader::seek(size_t index)
+{
+    cursor = std::min(index, recordCount);
+}
\ No newline at end of file
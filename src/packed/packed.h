@@ -0,0 +1,94 @@
+#pragma once
+
+#include "board/board.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Fixed-size 32-byte position record: an occupancy bitboard, a 4-bit code per
+// occupied square in ascending square order, then the game state. Records are
+// stored in host byte order (little-endian on every supported target).
+struct PackedPosition
+{
+    uint64_t occupancy;
+    uint8_t pieces[16]; // low nibble first; pawn..king = 0..5, +6 for black
+    uint16_t fullMoveNumber;
+    int16_t score;          // free for dataset tools, 0 from packPosition
+    uint8_t flags;          // bit 0 black to move, bits 1-4 castling KQkq
+    uint8_t enPassant;      // square, or 0xFF for none
+    uint8_t halfMoveClock;  // saturates at 255
+    int8_t result;          // free for dataset tools, 0 from packPosition
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+PackedPosition packPosition(const Board &board);
+
+// Throws std::runtime_error on a corrupt record, including one that decodes to a
+// position validatePosition rejects
+void decodePosition(const PackedPosition &packed, BoardArray &squares, GameState &state);
+
+// decodePosition into a board
+void unpackPosition(const PackedPosition &packed, Board &board);
+
+// Appends records through a buffered stream
+class PackedWriter
+{
+private:
+    std::ofstream file;
+    std::vector<PackedPosition> buffer;
+    size_t written;
+
+public:
+    explicit PackedWriter(const std::string &path, bool append = false);
+
+    ~PackedWriter();
+
+    PackedWriter(const PackedWriter &) = delete;
+
+    PackedWriter &operator=(const PackedWriter &) = delete;
+
+    void write(const PackedPosition &packed);
+
+    void write(const Board &board);
+
+    void flush();
+
+    // records written by this writer
+    size_t count() const;
+};
+
+// Memory-mapped record file with random access and a sequential cursor
+class PackedReader
+{
+private:
+    const PackedPosition *records;
+    size_t mappedSize;
+    size_t recordCount;
+    size_t cursor;
+
+public:
+    PackedReader();
+
+    explicit PackedReader(const std::string &path);
+
+    ~PackedReader();
+
+    PackedReader(const PackedReader &) = delete;
+
+    PackedReader &operator=(const PackedReader &) = delete;
+
+    void open(const std::string &path);
+
+    void close();
+
+    size_t size() const;
+
+    const PackedPosition &operator[](size_t index) const;
+
+    // next record from the cursor, false at the end
+    bool next(PackedPosition &packed);
+
+    void seek(size_t index);
+};
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "params.h"
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+const EvalParams defaultEvalParams = {
+    {100, 320, 330, 500, 900, 0},
+    {
+        // pawn
+        {0, 0, 0, 0, 0, 0, 0, 0,
+         50, 50, 50, 50, 50, 50, 50, 50,
+         10, 10, 20, 30, 30, 20, 10, 10,
+         5, 5, 10, 25, 25, 10, 5, 5,
+         0, 0, 0, 20, 20, 0, 0, 0,
+         5, -5, -10, 0, 0, -10, -5, 5,
+         5, 10, 10, -20, -20, 10, 10, 5,
+         0, 0, 0, 0, 0, 0, 0, 0},
+        // knight
+        {-50, -40, -30, -30, -30, -30, -40, -50,
+         -40, -20, 0, 0, 0, 0, -20, -40,
+         -30, 0, 10, 15, 15, 10, 0, -30,
+         -30, 5, 15, 20, 20, 15, 5, -30,
+         -30, 0, 15, 20, 20, 15, 0, -30,
+         -30, 5, 10, 15, 15, 10, 5, -30,
+         -40, -20, 0, 5, 5, 0, -20, -40,
+         -50, -40, -30, -30, -30, -30, -40, -50},
+        // bishop
+        {-20, -10, -10, -10, -10, -10, -10, -20,
+         -10, 0, 0, 0, 0, 0, 0, -10,
+         -10, 0, 5, 10, 10, 5, 0, -10,
+         -10, 5, 5, 10, 10, 5, 5, -10,
+         -10, 0, 10, 10, 10, 10, 0, -10,
+         -10, 10, 10, 10, 10, 10, 10, -10,
+         -10, 5, 0, 0, 0, 0, 5, -10,
+         -20, -10, -10, -10, -10, -10, -10, -20},
+        // rook
+        {0, 0, 0, 5, 5, 0, 0, 0,
+         -5, 0, 0, 0, 0, 0, 0, -5,
+         -5, 0, 0, 0, 0, 0, 0, -5,
+         -5, 0, 0, 0, 0, 0, 0, -5,
+         -5, 0, 0, 0, 0, 0, 0, -5,
+         -5, 0, 0, 0, 0, 0, 0, -5,
+         5, 10, 10, 10, 10, 10, 10, 5,
+         0, 0, 0, 0, 0, 0, 0, 0},
+        // queen
+        {-20, -10, -10, -5, -5, -10, -10, -20,
+         -10, 0, 0, 0, 0, 0, 0, -10,
+         -10, 0, 5, 5, 5, 5, 0, -10,
+         -5, 0, 5, 5, 5, 5, 0, -5,
+         0, 0, 5, 5, 5, 5, 0, -5,
+         -10, 5, 5, 5, 5, 5, 0, -10,
+         -10, 0, 5, 0, 0, 0, 0, -10,
+         -20, -10, -10, -5, -5, -10, -10, -20},
+        // king, middlegame
+        {-30, -40, -40, -50, -50, -40, -40, -30,
+         -30, -40, -40, -50, -50, -40, -40, -30,
+         -30, -40, -40, -50, -50, -40, -40, -30,
+         -30, -40, -40, -50, -50, -40, -40, -30,
+         -20, -30, -30, -40, -40, -30, -30, -20,
+         -10, -20, -20, -20, -20, -20, -20, -10,
+         20, 20, 0, 0, 0, 0, 20, 20,
+         20, 30, 10, 0, 0, 10, 30, 20}
+    },
+    0};
+
+static const char *const tableNames[6] = {"pawnPST", "knightPST", "bishopPST", "rookPST", "queenPST", "kingPST"};
+
+static std::atomic<const EvalParams *> activeParams(&defaultEvalParams);
+static std::mutex installMutex;
+static std::vector<std::unique_ptr<EvalParams>> installedParams;
+
+const EvalParams &evalParams()
+{
+    return *activeParams.load(std::memory_order_acquire);
+}
+
+// FNV-1a over the weights; equal sets share cache entries, which is harmless
+static uint64_t weightsKey(const EvalParams &params)
+{
+    unsigned char bytes[sizeof(params.pieceValue) + sizeof(params.pst)];
+    std::memcpy(bytes, params.pieceValue, sizeof(params.pieceValue));
+    std::memcpy(bytes + sizeof(params.pieceValue), params.pst, sizeof(params.pst));
+
+    uint64_t key = 0xCBF29CE484222325ULL;
+    for (unsigned char byte : bytes)
+    {
+        key = (key ^ byte) * 0x100000001B3ULL;
+    }
+    return key;
+}
+
+void setEvalParams(const EvalParams &params)
+{
+    std::lock_guard<std::mutex> lock(installMutex);
+    if (&params == &defaultEvalParams)
+    {
+        activeParams.store(&defaultEvalParams, std::memory_order_release);
+        return;
+    }
+
+    installedParams.push_back(std::make_unique<EvalParams>(params));
+    installedParams.back()->cacheKey = weightsKey(params);
+    activeParams.store(installedParams.back().get(), std::memory_order_release);
+}
+
+static void readNumbers(std::istream &in, int *values, int count, const std::string &name, const std::string &path)
+{
+    std::string token;
+    for (int i = 0; i < count; i++)
+    {
+        if (!(in >> token))
+        {
+            throw std::runtime_error(path + ": " + name + " needs " + std::to_string(count) + " numbers");
+        }
+        const char *end = token.data() + token.size();
+        auto [last, error] = std::from_chars(token.data(), end, values[i]);
+        if (error != std::errc() || last != end)
+        {
+            throw std::runtime_error(path + ": bad number '" + token + "' in " + name);
+        }
+        if (std::abs(values[i]) > maxEvalWeight)
+        {
+            throw std::runtime_error(path + ": " + name + " value " + token + " is outside +-" + std::to_string(maxEvalWeight) +
+                                     ", far beyond any real piece or square value");
+        }
+    }
+}
+
+EvalParams loadEvalParams(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    // comments are dropped up front so the rest is a plain token stream
+    std::stringstream text;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        text << line.substr(0, line.find('#')) << '\n';
+    }
+
+    EvalParams params = defaultEvalParams;
+    std::string name;
+    while (text >> name)
+    {
+        if (name == "pieceValue")
+        {
+            readNumbers(text, params.pieceValue, 6, name, path);
+            continue;
+        }
+
+        int type = 0;
+        while (type < 6 && name != tableNames[type])
+            type++;
+        if (type == 6)
+        {
+            throw std::runtime_error(path + ": unknown parameter " + name);
+        }
+        readNumbers(text, params.pst[type], 64, name, path);
+    }
+    return params;
+}
+
+void saveEvalParams(const std::string &path, const EvalParams &params, const std::string &comment)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+
+    if (!comment.empty())
+    {
+        file << "# " << comment << "\n\n";
+    }
+    file << "pieceValue";
+    for (int value : params.pieceValue)
+    {
+        file << ' ' << value;
+    }
+    file << '\n';
+
+    for (int type = 0; type < 6; type++)
+    {
+        file << '\n' << tableNames[type];
+        for (int sq = 0; sq < 64; sq++)
+        {
+            file << ((sq % 8 == 0) ? "\n   " : "") << ' ' << params.pst[type][sq];
+        }
+        file << '\n';
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
\ No newline at end of file
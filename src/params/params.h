@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Every weight of the static evaluation. Piece types are indexed pawn..king (0..5)
+// and the tables by square from white's side; black mirrors the rank.
+struct alignas(64) EvalParams
+{
+    int pieceValue[6]; // the king's is 0, both sides always have one
+    int pst[6][64];    // the king's table is for the middlegame
+    uint64_t cacheKey; // mixed into eval cache keys, so a replaced set's entries never hit
+};
+
+// Largest weight a parameter file may set. It only catches typos and runaway tuning: 15
+// pieces at this bound still add up past the mate scores, so the evaluation also clamps
+// its total below KNOWN_WIN.
+const int maxEvalWeight = 2000;
+
+// The weights compiled into the engine
+extern const EvalParams defaultEvalParams;
+
+// The set evaluate() uses
+const EvalParams &evalParams();
+
+// Makes a copy of params the active set. Swap between searches: a search running
+// across the swap would mix both sets. Replaced sets stay allocated, so a reference
+// taken before the swap never dangles.
+void setEvalParams(const EvalParams &params);
+
+// Reads a parameter file: '#' comments, then any of "pieceValue" with 6 numbers and
+// "pawnPST", "knightPST", "bishopPST", "rookPST", "queenPST", "kingPST" with 64 each,
+// in square order. Entries left out keep the compiled defaults. Throws
+// std::runtime_error on an unknown name, a bad or out of range number or a missing file.
+EvalParams loadEvalParams(const std::string &path);
+
+void saveEvalParams(const std::string &path, const EvalParams &params, const std::string &comment = "");
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "pgn.h"
+#include "notation/notation.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+static const char *const standardFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+std::string PgnGame::tag(const std::string &name) const
+{
+    for (const auto &entry : tags)
+    {
+        if (entry.first == name)
+        {
+            return entry.second;
+        }
+    }
+    return "";
+}
+
+PgnReader::PgnReader(const std::string &path, size_t bufferSize)
+    : file(path, std::ios::binary), buffer(bufferSize), position(0), filled(0), lineNumber(1), gameCount(0), lineStart(true), token()
+{
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+}
+
+int PgnReader::peek()
+{
+    if (position == filled)
+    {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        filled = static_cast<size_t>(file.gcount());
+        position = 0;
+        if (filled == 0)
+        {
+            return EOF;
+        }
+    }
+    return static_cast<unsigned char>(buffer[position]);
+}
+
+int PgnReader::get()
+{
+    int c = peek();
+    if (c != EOF)
+    {
+        position++;
+        lineNumber += (c == '\n') ? 1 : 0;
+        lineStart = (c == '\n');
+    }
+    return c;
+}
+
+void PgnReader::skipWhitespace()
+{
+    while (peek() != EOF && std::isspace(peek()))
+    {
+        get();
+    }
+}
+
+void PgnReader::skipUntil(char end)
+{
+    int c;
+    do
+    {
+        c = get();
+    } while (c != EOF && c != end);
+}
+
+void PgnReader::skipComments()
+{
+    while (true)
+    {
+        skipWhitespace();
+        int c = peek();
+        if (c == '{')
+            skipUntil('}');
+        else if (c == ';' || (c == '%' && lineStart))
+            skipUntil('\n');
+        else
+            return;
+    }
+}
+
+// [Name "value"], with \" and \\ escapes inside the value
+void PgnReader::readTag(PgnGame &game)
+{
+    get(); // '['
+    skipWhitespace();
+    std::string name;
+    while (peek() != EOF && !std::isspace(peek()) && peek() != '"' && peek() != ']')
+    {
+        name += static_cast<char>(get());
+    }
+    skipWhitespace();
+
+    std::string value;
+    if (peek() == '"')
+    {
+        get();
+        int c;
+        while ((c = get()) != EOF && c != '"' && c != '\n')
+        {
+            if (c == '\\' && (peek() == '"' || peek() == '\\'))
+                c = get();
+            value += static_cast<char>(c);
+        }
+    }
+    skipUntil(']');
+    game.tags.emplace_back(name, value);
+}
+
+// A run of symbol characters; PGN delimiters end it
+void PgnReader::readToken()
+{
+    token.clear();
+    int c;
+    while ((c = peek()) != EOF && !std::isspace(c) && c != '{' && c != '}' && c != '(' && c != ')' && c != ';' && c != '[' &&
+           c != ']' && c != '$')
+    {
+        token += static_cast<char>(get());
+    }
+}
+
+static bool isResult(const std::string &text)
+{
+    return text == "1-0" || text == "0-1" || text == "1/2-1/2" || text == "*";
+}
+
+bool PgnReader::readGame(PgnGame &game, Board &board, std::string &error, size_t &startLine)
+{
+    game.tags.clear();
+    game.moves.clear();
+    game.result.clear();
+    game.startFEN = standardFEN;
+    error.clear();
+
+    bool started = false;
+    bool inMoves = false;
+    int variationDepth = 0;
+    startLine = lineNumber;
+
+    while (true)
+    {
+        skipWhitespace();
+        int c = peek();
+        if (c == EOF)
+        {
+            break;
+        }
+
+        if (!started)
+        {
+            started = true;
+            startLine = lineNumber;
+        }
+
+        if (c == '[')
+        {
+            // a tag after the moves belongs to the next game, which had no result
+            if (inMoves)
+                break;
+            readTag(game);
+            continue;
+        }
+
+        if (!inMoves)
+        {
+            // the tag section is over: set up the starting position
+            inMoves = true;
+            std::string fen = game.tag("FEN");
+            if (!fen.empty())
+                game.startFEN = fen;
+            FenError fenError = board.parseFEN(game.startFEN);
+            if (fenError != FenError::None)
+            {
+                error = std::string("bad FEN tag: ") + toString(fenError);
+                board.parseFEN(standardFEN);
+            }
+        }
+
+        if (c == '{')
+        {
+            skipUntil('}');
+        }
+        else if (c == ';' || (c == '%' && lineStart))
+        {
+            skipUntil('\n');
+        }
+        else if (c == '(')
+        {
+            get();
+            variationDepth++;
+        }
+        else if (c == ')')
+        {
+            get();
+            variationDepth = std::max(variationDepth - 1, 0);
+        }
+        else if (c == '$' || c == ']' || c == '}')
+        {
+            get();
+            readToken(); // NAG number, or stray delimiter
+        }
+        else
+        {
+            readToken();
+            if (isResult(token))
+            {
+                if (variationDepth == 0)
+                {
+                    game.result = token;
+                    // a comment after the result still belongs to this game
+                    skipComments();
+                    break;
+                }
+                continue;
+            }
+
+            // move numbers: "12." and "12..." alone or glued to the move
+            size_t san = 0;
+            while (san < token.size() && std::isdigit(static_cast<unsigned char>(token[san])))
+                san++;
+            if (san == token.size())
+            {
+                continue; // a bare move number
+            }
+            if (token[san] == '.')
+            {
+                while (san < token.size() && token[san] == '.')
+                    san++;
+            }
+            else
+            {
+                san = 0; // "0-0" castling starts with a digit
+            }
+
+            if (san == token.size() || variationDepth > 0 || !error.empty() || token == "e.p.")
+            {
+                continue;
+            }
+
+            try
+            {
+                Move move = sanToMove(board, token.substr(san));
+                board.makeMove(move);
+                game.moves.push_back(move);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                error = std::string(e.what()) + " after " + std::to_string(game.moves.size()) + " plies";
+            }
+        }
+    }
+
+    return started;
+}
+
+bool PgnReader::next(PgnGame &game, Board &board)
+{
+    std::string error;
+    size_t startLine = 0;
+    do
+    {
+        if (!readGame(game, board, error, startLine))
+        {
+            return false;
+        }
+    } while (game.tags.empty() && game.moves.empty() && error.empty());
+    gameCount++;
+
+    if (!error.empty())
+    {
+        throw std::runtime_error("game " + std::to_string(gameCount) + " (line " + std::to_string(startLine) + "): " + error);
+    }
+    if (game.result.empty())
+    {
+        game.result = game.tag("Result").empty() ? "*" : game.tag("Result");
+    }
+    return true;
+}
+
+size_t PgnReader::gamesRead() const
+{
+    return gameCount;
+}
+
+size_t PgnReader::line() const
+{
+    return lineNumber;
+}
\ No newline at end of file
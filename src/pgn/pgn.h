@@ -0,0 +1,66 @@
+#pragma once
+
+#include "board/board.h"
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PgnGame
+{
+    std::vector<std::pair<std::string, std::string>> tags; // in file order
+    std::string startFEN;                                 // FEN tag, or the standard start position
+    MoveList moves;                                       // the main line; variations are skipped
+    std::string result;                                   // "1-0", "0-1", "1/2-1/2" or "*"
+
+    // value of a tag, empty when missing
+    std::string tag(const std::string &name) const;
+};
+
+// Reads a PGN file one game at a time through a fixed-size buffer, so files of any size
+// stream in constant memory. Comments, NAGs, escape lines and variations are skipped,
+// and the main line is replayed on a Board to resolve SAN.
+class PgnReader
+{
+private:
+    std::ifstream file;
+    std::vector<char> buffer;
+    size_t position;
+    size_t filled;
+    size_t lineNumber;
+    size_t gameCount;
+    bool lineStart; // nothing but the newline read yet on this line, for '%' escapes
+    std::string token;
+
+    int peek();
+
+    int get();
+
+    void skipWhitespace();
+
+    void skipUntil(char end);
+
+    // Whitespace, comments and escape lines
+    void skipComments();
+
+    void readTag(PgnGame &game);
+
+    void readToken();
+
+    // One game's tags and movetext, through its result or up to the next tag section.
+    // Returns false at the end of the file.
+    bool readGame(PgnGame &game, Board &board, std::string &error, size_t &startLine);
+
+public:
+    explicit PgnReader(const std::string &path, size_t bufferSize = 1 << 20);
+
+    // Reads the next game and leaves board at its final position. Returns false at the
+    // end of the file. A game with an illegal move or bad FEN is read to its end before
+    // std::runtime_error is thrown, so the caller can catch it and go on with the next game.
+    // Text with neither tags nor moves, like a stray result, is not counted as a game.
+    bool next(PgnGame &game, Board &board);
+
+    size_t gamesRead() const;
+
+    size_t line() const;
+};
\ No newline at end of file
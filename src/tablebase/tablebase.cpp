@@ -0,0 +1,1162 @@
+#include "tablebase.h"
+#include "generate/generate.h"
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Syzygy probing. The file layout, index encoding and decompression follow the
+// reference implementation by Ronald de Man (as used by Stockfish and Fathom).
+
+const uint8_t flagSTM = 1;
+const uint8_t flagMapped = 2;
+const uint8_t flagWinPlies = 4;
+const uint8_t flagLossPlies = 8;
+const uint8_t flagWide = 16;
+const uint8_t flagSingleValue = 128;
+
+const uint8_t wdlMagic[4] = {0x71, 0xE8, 0x23, 0x5D};
+const uint8_t dtzMagic[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+enum struct ProbeState
+{
+    Fail,
+    Ok,
+    ChangeSTM,      // a DTZ table stores the other side to move
+    ZeroingBestMove // the best move is a capture or pawn move, the stored value is not reliable
+};
+
+static uint32_t readLE16(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+}
+
+static uint32_t readLE32(const uint8_t *p)
+{
+    return readLE16(p) | (readLE16(p + 2) << 16);
+}
+
+static uint64_t readBE32(const uint8_t *p)
+{
+    return (static_cast<uint64_t>(p[0]) << 24) | (static_cast<uint64_t>(p[1]) << 16) | (static_cast<uint64_t>(p[2]) << 8) | p[3];
+}
+
+static uint64_t readBE64(const uint8_t *p)
+{
+    return (readBE32(p) << 32) | readBE32(p + 4);
+}
+
+// Decoding state for one side to move and, in pawn tables, one leading pawn file
+struct PairsData
+{
+    uint8_t flags = 0;
+    uint64_t sizeofBlock = 0;
+    uint64_t span = 0;
+    uint32_t numBlocks = 0;
+    uint32_t blockLengthSize = 0; // numBlocks plus padding
+    int maxSymLen = 0;
+    int minSymLen = 0;
+    const uint8_t *lowestSym = nullptr; // little-endian uint16 per symbol length
+    const uint8_t *btree = nullptr;     // 3 bytes per symbol: two 12-bit children
+    const uint8_t *blockLength = nullptr;
+    const uint8_t *sparseIndex = nullptr; // 6 bytes per entry: uint32 block, uint16 offset
+    uint64_t sparseIndexSize = 0;
+    const uint8_t *data = nullptr;
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;
+    int pieces[maxTablebasePieces] = {};
+    uint64_t groupIdx[maxTablebasePieces + 1] = {};
+    int groupLen[maxTablebasePieces + 1] = {};
+    uint16_t mapIdx[4] = {};
+
+    uint32_t left(uint32_t sym) const
+    {
+        const uint8_t *lr = btree + 3 * sym;
+        return ((lr[1] & 0xF) << 8) | lr[0];
+    }
+
+    uint32_t right(uint32_t sym) const
+    {
+        const uint8_t *lr = btree + 3 * sym;
+        return (static_cast<uint32_t>(lr[2]) << 4) | (lr[1] >> 4);
+    }
+};
+
+struct MappedFile
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data != nullptr)
+        {
+            munmap(const_cast<uint8_t *>(data), size);
+        }
+    }
+};
+
+// One material configuration, e.g. KRPvKR, with white as the side named first
+struct Table
+{
+    std::string white;
+    std::string black;
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    int pawnCount[2] = {}; // leading colour first
+
+    std::unique_ptr<MappedFile> wdlFile;
+    PairsData wdl[2][4]; // [side to move][leading pawn file]
+
+    std::unique_ptr<MappedFile> dtzFile;
+    PairsData dtz[4];
+    const uint8_t *dtzMap = nullptr;
+
+    bool symmetric() const
+    {
+        return white == black;
+    }
+};
+
+static std::vector<std::unique_ptr<Table>> tables;
+static std::map<std::string, Table *> tablesByMaterial;
+static int largestTable = 0;
+
+// Index encoding tables, see the reference implementation
+static int mapB1H1H7[64];
+static int mapA1D1D4[64];
+static int mapKK[10][64];
+static uint64_t binomial[maxTablebasePieces][64];
+static int mapPawns[64];
+static int leadPawnIdx[maxTablebasePieces][64];
+static int leadPawnsSize[maxTablebasePieces][4];
+static bool encodingReady = false;
+
+static int rankOf(int sq)
+{
+    return sq >> 3;
+}
+
+static int fileOf(int sq)
+{
+    return sq & 7;
+}
+
+static int offA1H8(int sq)
+{
+    return rankOf(sq) - fileOf(sq);
+}
+
+static bool kingsTouch(int a, int b)
+{
+    return std::abs(rankOf(a) - rankOf(b)) <= 1 && std::abs(fileOf(a) - fileOf(b)) <= 1;
+}
+
+static void initEncoding()
+{
+    int code = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (offA1H8(sq) < 0)
+            mapB1H1H7[sq] = code++;
+    }
+
+    // a1-d1-d4 triangle, diagonal squares last
+    std::vector<int> diagonal;
+    code = 0;
+    for (int sq = 0; sq <= 27; sq++)
+    {
+        if (offA1H8(sq) < 0 && fileOf(sq) <= 3)
+            mapA1D1D4[sq] = code++;
+        else if (offA1H8(sq) == 0 && fileOf(sq) <= 3)
+            diagonal.push_back(sq);
+    }
+    for (int sq : diagonal)
+    {
+        mapA1D1D4[sq] = code++;
+    }
+
+    // the 462 legal king pairs with the first king in the triangle; if it is on the
+    // diagonal the other is not above it, and pairs with both on the diagonal come last
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++)
+    {
+        for (int s1 = 0; s1 <= 27; s1++)
+        {
+            bool inTriangle = (offA1H8(s1) <= 0 && fileOf(s1) <= 3);
+            if (!inTriangle || mapA1D1D4[s1] != idx || (idx == 0 && s1 != 1))
+                continue;
+
+            for (int s2 = 0; s2 < 64; s2++)
+            {
+                if (kingsTouch(s1, s2))
+                    continue;
+                if (offA1H8(s1) == 0 && offA1H8(s2) > 0)
+                    continue;
+                if (offA1H8(s1) == 0 && offA1H8(s2) == 0)
+                    bothOnDiagonal.emplace_back(idx, s2);
+                else
+                    mapKK[idx][s2] = code++;
+            }
+        }
+    }
+    for (const auto &pair : bothOnDiagonal)
+    {
+        mapKK[pair.first][pair.second] = code++;
+    }
+
+    // binomial[k][n] ways to choose k of n squares
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++)
+    {
+        for (int k = 0; k < maxTablebasePieces && k <= n; k++)
+        {
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+        }
+    }
+
+    // mapPawns ranks pawn squares so the leading pawn (nearest the edge, then lowest)
+    // has the highest value; leading pawn indexes restart on every file
+    int availableSquares = 47;
+    for (int leadPawns = 1; leadPawns < maxTablebasePieces - 1; leadPawns++)
+    {
+        for (int file = 0; file < 4; file++)
+        {
+            int idx = 0;
+            for (int rank = 1; rank <= 6; rank++)
+            {
+                int sq = rank * 8 + file;
+                if (leadPawns == 1)
+                {
+                    mapPawns[sq] = availableSquares--;
+                    mapPawns[sq ^ 7] = availableSquares--;
+                }
+                leadPawnIdx[leadPawns][sq] = idx;
+                idx += static_cast<int>(binomial[leadPawns - 1][mapPawns[sq]]);
+            }
+            leadPawnsSize[leadPawns][file] = idx;
+        }
+    }
+
+    encodingReady = true;
+}
+
+static uint8_t setSymlen(PairsData &d, uint32_t sym, std::vector<bool> &visited)
+{
+    visited[sym] = true;
+    uint32_t right = d.right(sym);
+    if (right == 0xFFF)
+    {
+        return 0;
+    }
+    uint32_t left = d.left(sym);
+    if (!visited[left])
+        d.symlen[left] = setSymlen(d, left, visited);
+    if (!visited[right])
+        d.symlen[right] = setSymlen(d, right, visited);
+    return static_cast<uint8_t>(d.symlen[left] + d.symlen[right] + 1);
+}
+
+static void setGroups(const Table &table, PairsData &d, const int order[2], int file)
+{
+    int n = 0;
+    int firstLen = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+    d.groupLen[n] = 1;
+
+    // consecutive identical pieces form a group, except the leading group which
+    // holds the first two or three pieces without pawns
+    for (int i = 1; i < table.pieceCount; i++)
+    {
+        if (--firstLen > 0 || d.pieces[i] == d.pieces[i - 1])
+            d.groupLen[n]++;
+        else
+            d.groupLen[++n] = 1;
+    }
+    d.groupLen[++n] = 0;
+
+    bool pawnsOnBothSides = table.hasPawns && table.pawnCount[1] > 0;
+    int next = pawnsOnBothSides ? 2 : 1;
+    int freeSquares = 64 - d.groupLen[0] - (pawnsOnBothSides ? d.groupLen[1] : 0);
+    uint64_t idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++)
+    {
+        if (k == order[0])
+        {
+            d.groupIdx[0] = idx;
+            idx *= table.hasPawns ? static_cast<uint64_t>(leadPawnsSize[d.groupLen[0]][file]) : table.hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == order[1])
+        {
+            d.groupIdx[1] = idx;
+            idx *= binomial[d.groupLen[1]][48 - d.groupLen[0]];
+        }
+        else
+        {
+            d.groupIdx[next] = idx;
+            idx *= binomial[d.groupLen[next]][freeSquares];
+            freeSquares -= d.groupLen[next++];
+        }
+    }
+    d.groupIdx[n] = idx;
+}
+
+static const uint8_t *setSizes(PairsData &d, const uint8_t *data)
+{
+    d.flags = *data++;
+
+    if (d.flags & flagSingleValue)
+    {
+        d.minSymLen = *data++; // the single value
+        return data;
+    }
+
+    int groups = 0;
+    while (d.groupLen[groups] != 0)
+    {
+        groups++;
+    }
+    uint64_t tbSize = d.groupIdx[groups];
+
+    d.sizeofBlock = 1ULL << *data++;
+    d.span = 1ULL << *data++;
+    d.sparseIndexSize = (tbSize + d.span - 1) / d.span;
+    int padding = *data++;
+    d.numBlocks = readLE32(data);
+    data += 4;
+    d.blockLengthSize = d.numBlocks + static_cast<uint32_t>(padding);
+    d.maxSymLen = *data++;
+    d.minSymLen = *data++;
+    d.lowestSym = data;
+
+    // canonical Huffman: base64[len] is the smallest left-aligned code of each length
+    size_t lengths = static_cast<size_t>(d.maxSymLen - d.minSymLen + 1);
+    d.base64.assign(lengths, 0);
+    for (int i = static_cast<int>(lengths) - 2; i >= 0; i--)
+    {
+        d.base64[i] = (d.base64[i + 1] + readLE16(d.lowestSym + 2 * i) - readLE16(d.lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i < lengths; i++)
+    {
+        d.base64[i] <<= 64 - i - static_cast<size_t>(d.minSymLen);
+    }
+    data += lengths * 2;
+
+    // recursive pairing: every symbol expands to a left and right symbol
+    size_t symbols = readLE16(data);
+    data += 2;
+    d.symlen.assign(symbols, 0);
+    d.btree = data;
+    std::vector<bool> visited(symbols);
+    for (uint32_t sym = 0; sym < symbols; sym++)
+    {
+        if (!visited[sym])
+            d.symlen[sym] = setSymlen(d, sym, visited);
+    }
+
+    return data + symbols * 3 + (symbols & 1);
+}
+
+static const uint8_t *setDtzMap(Table &table, const uint8_t *base, const uint8_t *data, int maxFile)
+{
+    table.dtzMap = data;
+
+    for (int file = 0; file <= maxFile; file++)
+    {
+        PairsData &d = table.dtz[file];
+        if (!(d.flags & flagMapped))
+            continue;
+
+        if (d.flags & flagWide)
+        {
+            data += (data - base) & 1;
+            for (int i = 0; i < 4; i++)
+            {
+                d.mapIdx[i] = static_cast<uint16_t>((data - table.dtzMap) / 2 + 1);
+                data += 2 * readLE16(data) + 2;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                d.mapIdx[i] = static_cast<uint16_t>(data - table.dtzMap + 1);
+                data += *data + 1;
+            }
+        }
+    }
+
+    return data + ((data - base) & 1);
+}
+
+// Reads the table header that follows the magic; base is the page-aligned file start
+static void initTable(Table &table, const uint8_t *base, bool dtzTable)
+{
+    const uint8_t *data = base + 4;
+    data++; // flags: split sides, has pawns
+
+    int sides = (!dtzTable && !table.symmetric()) ? 2 : 1;
+    int maxFile = table.hasPawns ? 3 : 0;
+    bool pawnsOnBothSides = table.hasPawns && table.pawnCount[1] > 0;
+
+    auto pairs = [&](int side, int file) -> PairsData &
+    {
+        return dtzTable ? table.dtz[file] : table.wdl[side][file];
+    };
+
+    for (int file = 0; file <= maxFile; file++)
+    {
+        int order[2][2] = {{*data & 0xF, pawnsOnBothSides ? *(data + 1) & 0xF : 0xF},
+                           {*data >> 4, pawnsOnBothSides ? *(data + 1) >> 4 : 0xF}};
+        data += 1 + (pawnsOnBothSides ? 1 : 0);
+
+        for (int k = 0; k < table.pieceCount; k++, data++)
+        {
+            for (int side = 0; side < sides; side++)
+            {
+                pairs(side, file).pieces[k] = side ? *data >> 4 : *data & 0xF;
+            }
+        }
+
+        for (int side = 0; side < sides; side++)
+        {
+            setGroups(table, pairs(side, file), order[side], file);
+        }
+    }
+
+    data += (data - base) & 1;
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int side = 0; side < sides; side++)
+            data = setSizes(pairs(side, file), data);
+
+    if (dtzTable)
+        data = setDtzMap(table, base, data, maxFile);
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int side = 0; side < sides; side++)
+        {
+            pairs(side, file).sparseIndex = data;
+            data += pairs(side, file).sparseIndexSize * 6;
+        }
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int side = 0; side < sides; side++)
+        {
+            pairs(side, file).blockLength = data;
+            data += pairs(side, file).blockLengthSize * 2;
+        }
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int side = 0; side < sides; side++)
+        {
+            data = base + (((data - base) + 0x3F) & ~static_cast<ptrdiff_t>(0x3F));
+            pairs(side, file).data = data;
+            data += pairs(side, file).numBlocks * pairs(side, file).sizeofBlock;
+        }
+}
+
+static int decompressPairs(const PairsData &d, uint64_t idx)
+{
+    if (d.flags & flagSingleValue)
+    {
+        return d.minSymLen;
+    }
+
+    // the sparse index points into the block list near idx, walk from there
+    uint64_t k = idx / d.span;
+    const uint8_t *sparse = d.sparseIndex + 6 * k;
+    uint32_t block = readLE32(sparse);
+    int offset = static_cast<int>(readLE16(sparse + 4));
+    offset += static_cast<int>(idx % d.span) - static_cast<int>(d.span / 2);
+
+    while (offset < 0)
+        offset += static_cast<int>(readLE16(d.blockLength + 2 * (--block))) + 1;
+    while (offset > static_cast<int>(readLE16(d.blockLength + 2 * block)))
+        offset -= static_cast<int>(readLE16(d.blockLength + 2 * (block++))) + 1;
+
+    const uint8_t *ptr = d.data + static_cast<uint64_t>(block) * d.sizeofBlock;
+    uint64_t buf64 = readBE64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    uint32_t sym;
+
+    while (true)
+    {
+        int len = 0;
+        while (buf64 < d.base64[static_cast<size_t>(len)])
+        {
+            len++;
+        }
+
+        sym = static_cast<uint32_t>((buf64 - d.base64[static_cast<size_t>(len)]) >> (64 - len - d.minSymLen));
+        sym += readLE16(d.lowestSym + 2 * len);
+
+        if (offset < d.symlen[sym] + 1)
+            break;
+
+        offset -= d.symlen[sym] + 1;
+        len += d.minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+
+        if (buf64Size <= 32)
+        {
+            buf64Size += 32;
+            buf64 |= readBE32(ptr) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // descend the pair tree to the leaf that holds the value
+    while (d.symlen[sym] != 0)
+    {
+        uint32_t left = d.left(sym);
+        if (offset < d.symlen[left] + 1)
+        {
+            sym = left;
+        }
+        else
+        {
+            offset -= d.symlen[left] + 1;
+            sym = d.right(sym);
+        }
+    }
+
+    return static_cast<int>(d.left(sym));
+}
+
+// "KQR" style material for one colour, pieces in K Q R B N P order
+static std::string materialOf(const Board &board, Color color)
+{
+    static const PieceType order[] = {PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight, PieceType::Pawn};
+    int counts[7] = {};
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = board.pieceAt(sq);
+        if (p.type != PieceType::None && p.color == color)
+            counts[static_cast<int>(p.type)]++;
+    }
+    std::string material = "K";
+    for (PieceType type : order)
+    {
+        material.append(static_cast<size_t>(counts[static_cast<int>(type)]), "PNBRQK"[static_cast<int>(type) - 1]);
+    }
+    return material;
+}
+
+static int pieceCode(Piece p)
+{
+    return static_cast<int>(p.type) + (p.color == Color::Black ? 8 : 0);
+}
+
+static bool pawnsBefore(int a, int b)
+{
+    return mapPawns[a] < mapPawns[b];
+}
+
+static int mapScore(const Table &table, int file, int value, WDL wdl, bool dtzTable)
+{
+    if (!dtzTable)
+    {
+        return value - 2;
+    }
+
+    static const int wdlMap[] = {1, 3, 0, 2, 0};
+    const PairsData &d = table.dtz[file];
+    const uint16_t *idx = d.mapIdx;
+    int w = static_cast<int>(wdl) + 2;
+
+    if (d.flags & flagMapped)
+    {
+        if (d.flags & flagWide)
+            value = static_cast<int>(readLE16(table.dtzMap + 2 * (idx[wdlMap[w]] + value)));
+        else
+            value = table.dtzMap[idx[wdlMap[w]] + value];
+    }
+
+    // stored in moves unless flagged as plies
+    if ((wdl == WDL::Win && !(d.flags & flagWinPlies)) || (wdl == WDL::Loss && !(d.flags & flagLossPlies)) ||
+        wdl == WDL::CursedWin || wdl == WDL::BlessedLoss)
+    {
+        value *= 2;
+    }
+
+    return value + 1;
+}
+
+static Table *findTable(const Board &board, bool &blackStronger)
+{
+    std::string white = materialOf(board, Color::White);
+    std::string black = materialOf(board, Color::Black);
+    auto it = tablesByMaterial.find(white + "v" + black);
+    if (it == tablesByMaterial.end())
+    {
+        return nullptr;
+    }
+    blackStronger = (it->second->white != white);
+    return it->second;
+}
+
+static int probeTable(Board &board, bool dtzTable, WDL wdl, ProbeState &state)
+{
+    // no file exists for KvK, which captures into from every three-piece table
+    if (pieceCount(board) == 2)
+    {
+        return static_cast<int>(WDL::Draw);
+    }
+
+    bool blackStronger = false;
+    Table *table = findTable(board, blackStronger);
+    if (table == nullptr || (dtzTable ? table->dtzFile == nullptr : table->wdlFile == nullptr))
+    {
+        state = ProbeState::Fail;
+        return 0;
+    }
+
+    // tables are built with white as the side named first; symmetric tables only
+    // store white to move
+    bool blackToMove = board.sideToMove() == Color::Black;
+    bool flip = (table->symmetric() && blackToMove) || blackStronger;
+    int flipColor = flip ? 8 : 0;
+    int flipSquares = flip ? 56 : 0;
+    int stm = (flip ? 1 : 0) ^ (blackToMove ? 1 : 0);
+
+    int squares[maxTablebasePieces];
+    int pieces[maxTablebasePieces];
+    int size = 0;
+    int leadPawnsCount = 0;
+    int tbFile = 0;
+    uint64_t leadPawns = 0;
+
+    if (table->hasPawns)
+    {
+        int leadCode = (dtzTable ? table->dtz[0] : table->wdl[0][0]).pieces[0] ^ flipColor;
+        Color leadColor = (leadCode & 8) ? Color::Black : Color::White;
+        for (int sq = 0; sq < 64; sq++)
+        {
+            Piece p = board.pieceAt(sq);
+            if (p.type == PieceType::Pawn && p.color == leadColor)
+            {
+                leadPawns |= 1ULL << sq;
+                squares[size++] = sq ^ flipSquares;
+            }
+        }
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsBefore));
+        tbFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    if (dtzTable)
+    {
+        uint8_t flags = table->dtz[tbFile].flags;
+        if ((flags & flagSTM) != stm && !(table->symmetric() && !table->hasPawns))
+        {
+            state = ProbeState::ChangeSTM;
+            return 0;
+        }
+    }
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        Piece p = board.pieceAt(sq);
+        if (p.type == PieceType::None || (leadPawns & (1ULL << sq)))
+            continue;
+        squares[size] = sq ^ flipSquares;
+        pieces[size++] = pieceCode(p) ^ flipColor;
+    }
+
+    const PairsData &d = dtzTable ? table->dtz[tbFile] : table->wdl[stm][tbFile];
+
+    // put the pieces in the order the table encodes them
+    for (int i = leadPawnsCount; i < size - 1; i++)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            if (d.pieces[i] == pieces[j])
+            {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // mirror so the leading piece is on files a-d
+    if (fileOf(squares[0]) > 3)
+    {
+        for (int i = 0; i < size; i++)
+            squares[i] ^= 7;
+    }
+
+    uint64_t idx;
+    if (table->hasPawns)
+    {
+        idx = static_cast<uint64_t>(leadPawnIdx[leadPawnsCount][squares[0]]);
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsBefore);
+        for (int i = 1; i < leadPawnsCount; i++)
+        {
+            idx += binomial[i][mapPawns[squares[i]]];
+        }
+    }
+    else
+    {
+        // without pawns also mirror to ranks 1-4 and below the a1-h8 diagonal
+        if (rankOf(squares[0]) > 3)
+        {
+            for (int i = 0; i < size; i++)
+                squares[i] ^= 56;
+        }
+
+        for (int i = 0; i < d.groupLen[0]; i++)
+        {
+            if (offA1H8(squares[i]) == 0)
+                continue;
+            if (offA1H8(squares[i]) > 0)
+            {
+                for (int j = i; j < size; j++)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (table->hasUniquePieces)
+        {
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0]))
+                idx = static_cast<uint64_t>((mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2);
+            else if (offA1H8(squares[1]))
+                idx = static_cast<uint64_t>((6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2);
+            else if (offA1H8(squares[2]))
+                idx = static_cast<uint64_t>(6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 + (rankOf(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]]);
+            else
+                idx = static_cast<uint64_t>(6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 + (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2));
+        }
+        else
+        {
+            idx = static_cast<uint64_t>(mapKK[mapA1D1D4[squares[0]]][squares[1]]);
+        }
+    }
+
+    // the remaining groups, each as a combination of the squares left to it
+    idx *= d.groupIdx[0];
+    int *groupSquares = squares + d.groupLen[0];
+    bool remainingPawns = table->hasPawns && table->pawnCount[1] > 0;
+
+    for (int next = 1; d.groupLen[next] != 0; next++)
+    {
+        std::stable_sort(groupSquares, groupSquares + d.groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d.groupLen[next]; i++)
+        {
+            int adjust = static_cast<int>(std::count_if(squares, groupSquares, [&](int sq)
+                                                        { return groupSquares[i] > sq; }));
+            n += binomial[i + 1][groupSquares[i] - adjust - (remainingPawns ? 8 : 0)];
+        }
+        remainingPawns = false;
+        idx += n * d.groupIdx[next];
+        groupSquares += d.groupLen[next];
+    }
+
+    state = ProbeState::Ok;
+    return mapScore(*table, tbFile, decompressPairs(d, idx), wdl, dtzTable);
+}
+
+static bool isZeroing(const Board &board, const Move &m)
+{
+    return m.type == MoveType::Capture || m.type == MoveType::EnPassant || board.pieceAt(m.to).type != PieceType::None ||
+           board.pieceAt(m.from).type == PieceType::Pawn;
+}
+
+static bool isCapture(const Board &board, const Move &m)
+{
+    return m.type == MoveType::Capture || m.type == MoveType::EnPassant || board.pieceAt(m.to).type != PieceType::None;
+}
+
+// Resolves captures (and pawn moves when checkZeroing) before trusting the table,
+// which knows nothing of en passant and may be wrong where the best move zeroes
+static WDL searchWDL(Board &board, bool checkZeroing, ProbeState &state)
+{
+    WDL bestValue = WDL::Loss;
+    MoveList moves = generateLegalMoves(board);
+    size_t moveCount = 0;
+
+    for (const Move &m : moves)
+    {
+        if (!isCapture(board, m) && (!checkZeroing || board.pieceAt(m.from).type != PieceType::Pawn))
+            continue;
+
+        moveCount++;
+        board.makeMove(m);
+        WDL value = static_cast<WDL>(-static_cast<int>(searchWDL(board, false, state)));
+        board.unMakeMove();
+
+        if (state == ProbeState::Fail)
+            return WDL::Draw;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value >= WDL::Win)
+            {
+                state = ProbeState::ZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    bool noMoreMoves = moveCount > 0 && moveCount == moves.size();
+    WDL value;
+    if (noMoreMoves)
+    {
+        value = bestValue;
+    }
+    else
+    {
+        value = static_cast<WDL>(probeTable(board, false, WDL::Draw, state));
+        if (state == ProbeState::Fail)
+            return WDL::Draw;
+    }
+
+    if (bestValue >= value)
+    {
+        state = (bestValue > WDL::Draw || noMoreMoves) ? ProbeState::ZeroingBestMove : ProbeState::Ok;
+        return bestValue;
+    }
+
+    state = ProbeState::Ok;
+    return value;
+}
+
+static int dtzBeforeZeroing(WDL wdl)
+{
+    switch (wdl)
+    {
+    case WDL::Win:
+        return 1;
+    case WDL::CursedWin:
+        return 101;
+    case WDL::BlessedLoss:
+        return -101;
+    case WDL::Loss:
+        return -1;
+    case WDL::Draw:
+        return 0;
+    }
+    return 0;
+}
+
+static int signOf(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static bool probeable(const Board &board)
+{
+    CastlingAllowed castling = board.castlingAllowed();
+    bool canCastle = castling.whiteKingSide || castling.whiteQueenSide || castling.blackKingSide || castling.blackQueenSide;
+    return !canCastle && largestTable > 0 && pieceCount(board) <= largestTable;
+}
+
+static int probeDTZState(Board &board, ProbeState &state)
+{
+    state = ProbeState::Ok;
+    WDL wdl = searchWDL(board, true, state);
+
+    if (state == ProbeState::Fail || wdl == WDL::Draw)
+        return 0;
+
+    if (state == ProbeState::ZeroingBestMove)
+        return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(board, true, wdl, state);
+    if (state == ProbeState::Fail)
+        return 0;
+
+    if (state != ProbeState::ChangeSTM)
+        return (dtz + 100 * (wdl == WDL::BlessedLoss || wdl == WDL::CursedWin)) * signOf(static_cast<int>(wdl));
+
+    // the table holds the other side to move: take the best reply one ply down
+    int minDTZ = 0xFFFF;
+    MoveList moves = generateLegalMoves(board);
+    for (const Move &m : moves)
+    {
+        bool zeroing = isZeroing(board, m);
+        board.makeMove(m);
+
+        dtz = zeroing ? -dtzBeforeZeroing(searchWDL(board, false, state)) : -probeDTZState(board, state);
+
+        if (dtz == 1 && board.kingInCheck() && !hasLegalMove(board))
+            minDTZ = 1;
+
+        if (!zeroing)
+            dtz += signOf(dtz);
+
+        if (dtz < minDTZ && signOf(dtz) == signOf(static_cast<int>(wdl)))
+            minDTZ = dtz;
+
+        board.unMakeMove();
+
+        if (state == ProbeState::Fail)
+            return 0;
+    }
+
+    return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+int pieceCount(const Board &board)
+{
+    int count = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        if (board.pieceAt(sq).type != PieceType::None)
+            count++;
+    }
+    return count;
+}
+
+bool probeWDL(Board &board, WDL &result)
+{
+    if (!probeable(board))
+    {
+        return false;
+    }
+    ProbeState state = ProbeState::Ok;
+    result = searchWDL(board, false, state);
+    return state != ProbeState::Fail;
+}
+
+bool probeDTZ(Board &board, int &dtz)
+{
+    if (!probeable(board))
+    {
+        return false;
+    }
+    ProbeState state = ProbeState::Ok;
+    dtz = probeDTZState(board, state);
+    return state != ProbeState::Fail;
+}
+
+bool probeRoot(Board &board, MoveList &moves, WDL &result)
+{
+    if (!probeable(board) || moves.empty())
+    {
+        return false;
+    }
+
+    // DTZ of every move counted from the root, in plies
+    std::vector<int> moveDTZ;
+    for (const Move &m : moves)
+    {
+        bool zeroing = isZeroing(board, m);
+        board.makeMove(m);
+
+        ProbeState state = ProbeState::Ok;
+        int dtz;
+        if (zeroing)
+        {
+            WDL wdl = static_cast<WDL>(-static_cast<int>(searchWDL(board, false, state)));
+            dtz = dtzBeforeZeroing(wdl);
+        }
+        else
+        {
+            dtz = -probeDTZState(board, state);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+        if (board.kingInCheck() && !hasLegalMove(board))
+            dtz = 1;
+
+        board.unMakeMove();
+
+        if (state == ProbeState::Fail)
+            return false;
+        moveDTZ.push_back(dtz);
+    }
+
+    // a win is the fastest conversion, a loss the slowest; the fifty-move rule decides cursed results
+    auto rank = [](int dtz)
+    {
+        return dtz > 0 ? 1000 - dtz : dtz < 0 ? -1000 - dtz : 0;
+    };
+    int best = rank(moveDTZ[0]);
+    for (int dtz : moveDTZ)
+    {
+        best = std::max(best, rank(dtz));
+    }
+
+    MoveList kept;
+    int keptDTZ = 0;
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        if (rank(moveDTZ[i]) == best)
+        {
+            kept.push_back(moves[i]);
+            keptDTZ = moveDTZ[i];
+        }
+    }
+    moves = kept;
+
+    int clock = board.halfMoveCounter();
+    if (keptDTZ > 0)
+        result = (keptDTZ + clock <= 100) ? WDL::Win : WDL::CursedWin;
+    else if (keptDTZ < 0)
+        result = (-keptDTZ + clock <= 100) ? WDL::Loss : WDL::BlessedLoss;
+    else
+        result = WDL::Draw;
+    return true;
+}
+
+// "KRPvKR" -> white "KRP", black "KR"; empty when the name is not a Syzygy material
+static bool parseMaterial(const std::string &name, std::string &white, std::string &black)
+{
+    size_t v = name.find('v');
+    if (v == std::string::npos)
+        return false;
+    white = name.substr(0, v);
+    black = name.substr(v + 1);
+    for (const std::string *side : {&white, &black})
+    {
+        if (side->empty() || (*side)[0] != 'K' || side->find_first_not_of("KQRBNP") != std::string::npos ||
+            std::count(side->begin(), side->end(), 'K') != 1)
+            return false;
+    }
+    return white.size() + black.size() <= static_cast<size_t>(maxTablebasePieces);
+}
+
+static std::unique_ptr<MappedFile> mapTableFile(const std::string &path, const uint8_t magic[4])
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("cannot open tablebase " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size % 64 != 16)
+    {
+        ::close(fd);
+        throw std::runtime_error("corrupt tablebase " + path);
+    }
+
+    auto file = std::make_unique<MappedFile>();
+    file->size = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, file->size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map tablebase " + path);
+    }
+    file->data = static_cast<const uint8_t *>(mapped);
+
+    if (std::memcmp(file->data, magic, 4) != 0)
+    {
+        throw std::runtime_error("corrupt tablebase " + path);
+    }
+    return file;
+}
+
+static Table &tableFor(const std::string &white, const std::string &black)
+{
+    auto it = tablesByMaterial.find(white + "v" + black);
+    if (it != tablesByMaterial.end())
+    {
+        return *it->second;
+    }
+
+    auto table = std::make_unique<Table>();
+    table->white = white;
+    table->black = black;
+    table->pieceCount = static_cast<int>(white.size() + black.size());
+
+    int whitePawns = static_cast<int>(std::count(white.begin(), white.end(), 'P'));
+    int blackPawns = static_cast<int>(std::count(black.begin(), black.end(), 'P'));
+    table->hasPawns = whitePawns + blackPawns > 0;
+
+    // the side with fewer pawns leads, as it compresses better
+    bool whiteLeads = blackPawns == 0 || (whitePawns > 0 && blackPawns >= whitePawns);
+    table->pawnCount[0] = whiteLeads ? whitePawns : blackPawns;
+    table->pawnCount[1] = whiteLeads ? blackPawns : whitePawns;
+
+    for (const std::string &side : {white, black})
+    {
+        for (char piece : std::string("QRBNP"))
+        {
+            if (std::count(side.begin(), side.end(), piece) == 1)
+                table->hasUniquePieces = true;
+        }
+    }
+
+    Table *raw = table.get();
+    tables.push_back(std::move(table));
+    tablesByMaterial[white + "v" + black] = raw;
+    tablesByMaterial[black + "v" + white] = raw;
+    return *raw;
+}
+
+int initTablebases(const std::string &paths)
+{
+    if (!encodingReady)
+    {
+        initEncoding();
+    }
+
+    tablesByMaterial.clear();
+    tables.clear();
+    largestTable = 0;
+
+    int wdlCount = 0;
+    std::stringstream directories(paths);
+    std::string directory;
+    while (std::getline(directories, directory, ':'))
+    {
+        std::error_code error;
+        if (directory.empty() || !std::filesystem::is_directory(directory, error))
+            continue;
+
+        for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+        {
+            std::string extension = entry.path().extension().string();
+            bool dtzTable = extension == ".rtbz";
+            std::string white, black;
+            if ((extension != ".rtbw" && !dtzTable) || !parseMaterial(entry.path().stem().string(), white, black))
+                continue;
+
+            Table &table = tableFor(white, black);
+            std::unique_ptr<MappedFile> &file = dtzTable ? table.dtzFile : table.wdlFile;
+            if (file != nullptr)
+                continue; // the same table in an earlier directory wins
+
+            file = mapTableFile(entry.path().string(), dtzTable ? dtzMagic : wdlMagic);
+            initTable(table, file->data, dtzTable);
+
+            if (!dtzTable)
+            {
+                wdlCount++;
+                largestTable = std::max(largestTable, table.pieceCount);
+            }
+        }
+    }
+
+    return wdlCount;
+}
+
+int tablebaseLargest()
+{
+    return largestTable;
+}
\ No newline at end of file
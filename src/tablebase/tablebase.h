@@ -0,0 +1,38 @@
+#pragma once
+
+#include "board/board.h"
+#include <string>
+
+// Win/draw/loss from the side to move's view. Cursed wins and blessed losses
+// are decided by the fifty-move rule and count as draws over the board.
+enum struct WDL
+{
+    Loss = -2,
+    BlessedLoss = -1,
+    Draw = 0,
+    CursedWin = 1,
+    Win = 2
+};
+
+const int maxTablebasePieces = 7;
+
+// Maps every Syzygy table (.rtbw/.rtbz) in the given ':'-separated directories,
+// replacing the previous set. Returns the number of WDL tables found.
+int initTablebases(const std::string &paths);
+
+// Most pieces covered by the loaded WDL tables, 0 when none are loaded
+int tablebaseLargest();
+
+int pieceCount(const Board &board);
+
+// Both probes fail (return false) for positions with castling rights, more pieces
+// than the tables cover, or material without a table.
+bool probeWDL(Board &board, WDL &result);
+
+// Plies to the next capture or pawn move on the best path, signed like the WDL result;
+// cursed wins and blessed losses are offset by 100
+bool probeDTZ(Board &board, int &dtz);
+
+// Keeps only the root moves that best preserve the tablebase result: the fastest
+// conversion when winning, drawing moves when drawn, the longest resistance when lost
+bool probeRoot(Board &board, MoveList &moves, WDL &result);
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "timeman.h"
+#include <algorithm>
+
+static std::chrono::steady_clock::rep clockTicks()
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+TimeManager::TimeManager() : startTime(clockTicks()), softLimit(0), hardLimit(0), timed(false), nodeLimit(0), nodes(0), nextTimeCheck(timeCheckInterval), stop(false), pondering(false)
+{
+}
+
+void TimeManager::start(const SearchLimits &limits, Color side)
+{
+    startTime = clockTicks();
+    stop = false;
+    pondering = limits.ponder;
+    nodes = 0;
+    nextTimeCheck = timeCheckInterval;
+    nodeLimit = limits.nodes;
+    timed = false;
+
+    if (limits.infinite)
+    {
+        return;
+    }
+
+    if (limits.moveTime >= 0)
+    {
+        timed = true;
+        softLimit = std::max(0.0, limits.moveTime / 1000.0 - moveOverhead);
+        hardLimit = softLimit;
+        return;
+    }
+
+    int clock = (side == Color::White) ? limits.whiteTime : limits.blackTime;
+    int increment = (side == Color::White) ? limits.whiteIncrement : limits.blackIncrement;
+    if (clock < 0)
+    {
+        return;
+    }
+
+    // assume a fixed horizon when the GUI does not tell us how many moves are left
+    int movesLeft = (limits.movesToGo > 0) ? std::min(limits.movesToGo, 50) : 30;
+    double remaining = std::max(0.0, clock / 1000.0 - moveOverhead);
+
+    timed = true;
+    softLimit = std::min(remaining / movesLeft + increment / 1000.0 * 0.75, remaining);
+    hardLimit = std::min(softLimit * 4.0, remaining * 0.5);
+    hardLimit = std::max(hardLimit, std::min(softLimit, remaining));
+}
+
+void TimeManager::start(double timeLimit)
+{
+    startTime = clockTicks();
+    stop = false;
+    pondering = false;
+    nodes = 0;
+    nextTimeCheck = timeCheckInterval;
+    nodeLimit = 0;
+    timed = true;
+    softLimit = timeLimit;
+    hardLimit = timeLimit;
+}
+
+// The opponent played the expected move: the budgets computed at start() now
+// apply, measured from this moment, while the search keeps running.
+void TimeManager::ponderHit()
+{
+    startTime = clockTicks();
+    pondering = false;
+}
+
+// Called once per node. The clock is only read every timeCheckInterval nodes,
+// other threads may raise the stop flag at any time.
+bool TimeManager::checkUp()
+{
+    nodes++;
+
+    if (nodeLimit != 0 && nodes >= nodeLimit)
+    {
+        stop = true;
+    }
+
+    if (timed && nodes >= nextTimeCheck)
+    {
+        nextTimeCheck = nodes + timeCheckInterval;
+        if (!pondering.load(std::memory_order_relaxed) && elapsed() >= hardLimit)
+        {
+            stop = true;
+        }
+    }
+
+    return stop.load(std::memory_order_relaxed);
+}
+
+void TimeManager::addNodes(uint64_t count)
+{
+    nodes += count;
+}
+
+bool TimeManager::stopped() const
+{
+    return stop.load(std::memory_order_relaxed);
+}
+
+double TimeManager::elapsed() const
+{
+    std::chrono::steady_clock::duration ticks(clockTicks() - startTime.load(std::memory_order_relaxed));
+    return std::chrono::duration<double>(ticks).count();
+}
+
+double TimeManager::softBudget() const
+{
+    return softLimit;
+}
+
+double TimeManager::hardBudget() const
+{
+    return hardLimit;
+}
+
+uint64_t TimeManager::nodeCount() const
+{
+    return nodes;
+}
+
+// Decides between iterations whether another one is worth starting. A best move
+// that keeps changing earns extra time, a stable one lets us stop early.
+bool TimeManager::shouldStartIteration(double lastIterationTime, int bestMoveStability) const
+{
+    if (stopped())
+    {
+        return false;
+    }
+    if (!timed || pondering.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+
+    double now = elapsed();
+
+    // fixed time per move, spend all of it
+    if (softLimit >= hardLimit)
+    {
+        return now < hardLimit;
+    }
+
+    double budget = softLimit;
+    if (bestMoveStability == 0)
+    {
+        budget *= 1.4;
+    }
+    else if (bestMoveStability >= 4)
+    {
+        budget *= 0.6;
+    }
+    budget = std::min(budget, hardLimit);
+
+    if (now >= budget)
+    {
+        return false;
+    }
+
+    // the next iteration usually costs a few times the previous one
+    return now + lastIterationTime * 2.0 < hardLimit;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "board/board.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Search limits as received from the GUI. Times are in milliseconds, -1 means unset.
+struct SearchLimits
+{
+    int whiteTime = -1;
+    int blackTime = -1;
+    int whiteIncrement = 0;
+    int blackIncrement = 0;
+    int movesToGo = 0;
+    int moveTime = -1;
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+    bool ponder = false;
+};
+
+const uint64_t timeCheckInterval = 2048;
+const double moveOverhead = 0.03;
+
+class TimeManager
+{
+private:
+    std::atomic<std::chrono::steady_clock::rep> startTime; // ponderhit resets it while the search runs
+    double softLimit;
+    double hardLimit;
+    bool timed;
+    uint64_t nodeLimit;
+    uint64_t nodes;
+    uint64_t nextTimeCheck;
+
+public:
+    std::atomic<bool> stop;
+    std::atomic<bool> pondering;
+
+    TimeManager();
+
+    void start(const SearchLimits &limits, Color side);
+
+    void start(double timeLimit);
+
+    void ponderHit();
+
+    bool checkUp();
+
+    // Charges nodes searched without a checkUp call, i.e. quiescence, to the node limit
+    void addNodes(uint64_t count);
+
+    bool stopped() const;
+
+    double elapsed() const;
+
+    double softBudget() const;
+
+    double hardBudget() const;
+
+    uint64_t nodeCount() const;
+
+    bool shouldStartIteration(double lastIterationTime, int bestMoveStability) const;
+};
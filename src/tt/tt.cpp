@@ -0,0 +1,100 @@
+#include "tt.h"
+#include <algorithm>
+
+TranspositionTable transpositionTable(16);
+
+// data layout: move (18 bits) | score (16) | depth (8) | bound (2)
+static uint64_t pack(const TTEntry &entry)
+{
+    uint64_t move = static_cast<uint64_t>(entry.move.from) | static_cast<uint64_t>(entry.move.to) << 6 |
+                    static_cast<uint64_t>(entry.move.type) << 12 | static_cast<uint64_t>(entry.move.promotion) << 15;
+    uint64_t score = static_cast<uint16_t>(static_cast<int16_t>(entry.score));
+    uint64_t depth = static_cast<uint8_t>(entry.depth);
+    uint64_t bound = static_cast<uint64_t>(entry.bound);
+    return move | score << 18 | depth << 34 | bound << 42;
+}
+
+static TTEntry unpack(uint64_t data)
+{
+    TTEntry entry;
+    entry.move.from = static_cast<int>(data & 63);
+    entry.move.to = static_cast<int>((data >> 6) & 63);
+    entry.move.type = static_cast<MoveType>((data >> 12) & 7);
+    entry.move.promotion = static_cast<PieceType>((data >> 15) & 7);
+    entry.score = static_cast<int16_t>((data >> 18) & 0xFFFF);
+    entry.depth = static_cast<int>((data >> 34) & 0xFF);
+    entry.bound = static_cast<Bound>((data >> 42) & 3);
+    return entry;
+}
+
+TranspositionTable::TranspositionTable(size_t sizeMB) : slots(), mask(0)
+{
+    resize(sizeMB);
+}
+
+void TranspositionTable::resize(size_t sizeMB)
+{
+    size_t count = 1;
+    size_t maxCount = (sizeMB * 1024 * 1024) / sizeof(Slot);
+    while (count * 2 <= maxCount)
+    {
+        count *= 2;
+    }
+
+    slots = std::make_unique<Slot[]>(count);
+    mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i <= mask; i++)
+    {
+        slots[i].key.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const
+{
+    const Slot &slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.key.load(std::memory_order_relaxed) ^ data) != key || data == 0)
+    {
+        return false;
+    }
+
+    entry = unpack(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry &entry)
+{
+    Slot &slot = slots[key & mask];
+    uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+    uint64_t oldKey = slot.key.load(std::memory_order_relaxed) ^ oldData;
+
+    // keep deeper results for the same position, always replace other positions
+    if (oldKey == key && unpack(oldData).depth > entry.depth && entry.bound != Bound::Exact)
+    {
+        return;
+    }
+
+    uint64_t data = pack(entry);
+    slot.key.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t sample = std::min<size_t>(1000, mask + 1);
+    size_t used = 0;
+    for (size_t i = 0; i < sample; i++)
+    {
+        if (slots[i].data.load(std::memory_order_relaxed) != 0)
+        {
+            used++;
+        }
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
\ No newline at end of file
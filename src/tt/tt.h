@@ -0,0 +1,53 @@
+#pragma once
+
+#include "board/board.h"
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+enum struct Bound
+{
+    None,
+    Upper,
+    Lower,
+    Exact
+};
+
+struct TTEntry
+{
+    Move move;
+    int score = 0;
+    int depth = 0;
+    Bound bound = Bound::None;
+};
+
+// Shared transposition table. Every slot stores the key xor-ed with its data, so a
+// slot torn by two concurrent writers fails verification instead of returning garbage.
+class TranspositionTable
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+
+public:
+    explicit TranspositionTable(size_t sizeMB);
+
+    void resize(size_t sizeMB);
+
+    void clear();
+
+    bool probe(uint64_t key, TTEntry &entry) const;
+
+    void store(uint64_t key, const TTEntry &entry);
+
+    // Permille of used slots, sampled from the start of the table
+    int hashfull() const;
+};
+
+extern TranspositionTable transpositionTable;
@@ -0,0 +1,366 @@
+#include "tuner.h"
+#include "evaluate/evaluate.h"
+#include "packed/packed.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+static const double ln10 = std::log(10.0);
+
+static int materialIndex(int type)
+{
+    return type;
+}
+
+static int tableIndex(int type, int tableSq)
+{
+    return tunerMaterialCount + type * 64 + tableSq;
+}
+
+// Win probability for white of a white-view score
+static double sigmoid(double eval, double scale)
+{
+    return 1.0 / (1.0 + std::exp(-scale * eval * ln10 / 400.0));
+}
+
+TunerData::TunerData() : features(), offsets(1, 0), results(), scores(), targets()
+{
+}
+
+void TunerData::load(const std::string &path)
+{
+    PackedReader reader(path);
+    PackedPosition packed;
+    BoardArray squares;
+    GameState state;
+    uint16_t pieces[32];
+
+    for (size_t index = 0; reader.next(packed); index++)
+    {
+        std::string record = std::to_string(index);
+        if (packed.result < -1 || packed.result > 1)
+        {
+            throw std::runtime_error(path + ": bad result in record " + record);
+        }
+        try
+        {
+            decodePosition(packed, squares, state);
+        }
+        catch (const std::runtime_error &e)
+        {
+            throw std::runtime_error(path + ": " + e.what() + " in record " + record);
+        }
+
+        int count = 0;
+        int nonKings = 0;
+        for (int sq = 0; sq < 64; sq++)
+        {
+            Piece p = squares[static_cast<size_t>(sq)];
+            if (p.type == PieceType::None)
+                continue;
+
+            int code = static_cast<int>(p.type) - 1 + (p.color == Color::Black ? 6 : 0);
+            int tableSq = (p.color == Color::White) ? sq : mirror(sq);
+            pieces[count++] = static_cast<uint16_t>(code << 6 | tableSq);
+            nonKings += (p.type == PieceType::King) ? 0 : 1;
+        }
+
+        // evaluateEndgame replaces the weights in these
+        if (nonKings <= 2)
+        {
+            continue;
+        }
+
+        features.insert(features.end(), pieces, pieces + count);
+        offsets.push_back(static_cast<uint32_t>(features.size()));
+        results.push_back(static_cast<float>(packed.result + 1) / 2.0f);
+        scores.push_back(packed.score);
+    }
+}
+
+size_t TunerData::size() const
+{
+    return results.size();
+}
+
+void TunerData::setTargets(double lambda, double scale)
+{
+    targets.resize(results.size());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        targets[i] = static_cast<float>(lambda * results[i] + (1 - lambda) * sigmoid(scores[i], scale));
+    }
+}
+
+// Each thread sums its own slice of positions into a private gradient; the
+// slices are added up at the end so no position is touched by two threads
+double TunerData::loss(const std::vector<double> &params, double scale, int threads, bool useResults, std::vector<double> *gradient) const
+{
+    const std::vector<float> &labels = useResults ? results : targets;
+    size_t n = size();
+    size_t workers = static_cast<size_t>(std::max(1, threads));
+    std::vector<double> sums(workers, 0.0);
+    std::vector<std::vector<double>> gradients(gradient ? workers : 0, std::vector<double>(tunerParamCount, 0.0));
+
+    auto work = [&](size_t worker)
+    {
+        size_t begin = n * worker / workers;
+        size_t end = n * (worker + 1) / workers;
+        double *grad = gradient ? gradients[worker].data() : nullptr;
+        double sum = 0;
+
+        for (size_t i = begin; i < end; i++)
+        {
+            double eval = 0;
+            for (uint32_t f = offsets[i]; f < offsets[i + 1]; f++)
+            {
+                int code = features[f] >> 6;
+                int type = code % 6;
+                double weight = params[static_cast<size_t>(tableIndex(type, features[f] & 63))] +
+                                ((type < tunerMaterialCount) ? params[static_cast<size_t>(materialIndex(type))] : 0.0);
+                eval += (code < 6) ? weight : -weight;
+            }
+
+            double p = sigmoid(eval, scale);
+            double error = p - labels[i];
+            sum += error * error;
+
+            if (grad)
+            {
+                double slope = 2 * error * p * (1 - p) * scale * ln10 / 400.0;
+                for (uint32_t f = offsets[i]; f < offsets[i + 1]; f++)
+                {
+                    int code = features[f] >> 6;
+                    int type = code % 6;
+                    double signedSlope = (code < 6) ? slope : -slope;
+                    grad[tableIndex(type, features[f] & 63)] += signedSlope;
+                    if (type < tunerMaterialCount)
+                        grad[materialIndex(type)] += signedSlope;
+                }
+            }
+        }
+        sums[worker] = sum;
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t worker = 1; worker < workers; worker++)
+    {
+        pool.emplace_back(work, worker);
+    }
+    work(0);
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+
+    double total = 0;
+    for (double sum : sums)
+    {
+        total += sum;
+    }
+
+    if (gradient)
+    {
+        gradient->assign(tunerParamCount, 0.0);
+        for (const std::vector<double> &partial : gradients)
+        {
+            for (int j = 0; j < tunerParamCount; j++)
+            {
+                (*gradient)[static_cast<size_t>(j)] += partial[static_cast<size_t>(j)] / static_cast<double>(std::max<size_t>(n, 1));
+            }
+        }
+    }
+    return total / static_cast<double>(std::max<size_t>(n, 1));
+}
+
+std::vector<double> toTunerParams(const EvalParams &params)
+{
+    std::vector<double> values(tunerParamCount);
+    for (int type = 0; type < tunerMaterialCount; type++)
+    {
+        values[static_cast<size_t>(materialIndex(type))] = params.pieceValue[type];
+    }
+    for (int type = 0; type < 6; type++)
+    {
+        for (int sq = 0; sq < 64; sq++)
+        {
+            values[static_cast<size_t>(tableIndex(type, sq))] = params.pst[type][sq];
+        }
+    }
+    return values;
+}
+
+EvalParams toEvalParams(const std::vector<double> &params, const EvalParams &base)
+{
+    EvalParams result = base;
+    for (int type = 0; type < tunerMaterialCount; type++)
+    {
+        result.pieceValue[type] = std::clamp(static_cast<int>(std::lround(params[static_cast<size_t>(materialIndex(type))])), -maxEvalWeight, maxEvalWeight);
+    }
+    for (int type = 0; type < 6; type++)
+    {
+        for (int sq = 0; sq < 64; sq++)
+        {
+            result.pst[type][sq] = std::clamp(static_cast<int>(std::lround(params[static_cast<size_t>(tableIndex(type, sq))])), -maxEvalWeight, maxEvalWeight);
+        }
+    }
+    return result;
+}
+
+// Golden-section search; the loss is unimodal in K for a fixed evaluation
+double fitSigmoidScale(const TunerData &data, const std::vector<double> &params, int threads)
+{
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0.05;
+    double high = 5.0;
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    double lossA = data.loss(params, a, threads, true, nullptr);
+    double lossB = data.loss(params, b, threads, true, nullptr);
+
+    while (high - low > 1e-4)
+    {
+        if (lossA < lossB)
+        {
+            high = b;
+            b = a;
+            lossB = lossA;
+            a = high - ratio * (high - low);
+            lossA = data.loss(params, a, threads, true, nullptr);
+        }
+        else
+        {
+            low = a;
+            a = b;
+            lossA = lossB;
+            b = low + ratio * (high - low);
+            lossB = data.loss(params, b, threads, true, nullptr);
+        }
+    }
+    return (low + high) / 2;
+}
+
+// Material and a table's average over the squares the piece can stand on are
+// interchangeable, so the average is moved into the material weight
+static void centerTables(std::vector<double> &params)
+{
+    for (int type = 0; type < tunerMaterialCount; type++)
+    {
+        int first = (type == 0) ? 8 : 0; // pawns never stand on the first or last rank
+        int last = (type == 0) ? 56 : 64;
+        double mean = 0;
+        for (int sq = first; sq < last; sq++)
+        {
+            mean += params[static_cast<size_t>(tableIndex(type, sq))];
+        }
+        mean /= last - first;
+
+        for (int sq = first; sq < last; sq++)
+        {
+            params[static_cast<size_t>(tableIndex(type, sq))] -= mean;
+        }
+        params[static_cast<size_t>(materialIndex(type))] += mean;
+    }
+}
+
+TunerResult runTuner(const TunerSettings &settings)
+{
+    TunerData data;
+    for (const std::string &input : settings.inputs)
+    {
+        data.load(input);
+    }
+    if (data.size() == 0)
+    {
+        throw std::runtime_error("no positions to tune on");
+    }
+
+    TunerResult result;
+    result.positions = data.size();
+    result.params = toTunerParams(evalParams());
+    result.scale = (settings.scale > 0) ? settings.scale : fitSigmoidScale(data, result.params, settings.threads);
+    data.setTargets(settings.lambda, result.scale);
+    result.initialLoss = data.loss(result.params, result.scale, settings.threads, false, nullptr);
+    std::cout << result.positions << " positions, K " << std::setprecision(4) << result.scale << ", loss " << std::setprecision(8)
+              << result.initialLoss << std::endl;
+
+    // Adam
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    const double epsilon = 1e-8;
+    std::vector<double> gradient;
+    std::vector<double> m(tunerParamCount, 0.0);
+    std::vector<double> v(tunerParamCount, 0.0);
+    double loss = result.initialLoss;
+
+    for (int epoch = 1; epoch <= settings.epochs; epoch++)
+    {
+        loss = data.loss(result.params, result.scale, settings.threads, false, &gradient);
+
+        double correction1 = 1 - std::pow(beta1, epoch);
+        double correction2 = 1 - std::pow(beta2, epoch);
+        for (size_t j = 0; j < static_cast<size_t>(tunerParamCount); j++)
+        {
+            m[j] = beta1 * m[j] + (1 - beta1) * gradient[j];
+            v[j] = beta2 * v[j] + (1 - beta2) * gradient[j] * gradient[j];
+            result.params[j] -= settings.learningRate * (m[j] / correction1) / (std::sqrt(v[j] / correction2) + epsilon);
+        }
+
+        if (epoch % 100 == 0 || epoch == settings.epochs)
+        {
+            std::cout << "Epoch " << epoch << " loss " << loss << std::endl;
+        }
+    }
+
+    centerTables(result.params);
+    result.finalLoss = data.loss(result.params, result.scale, settings.threads, false, nullptr);
+
+    EvalParams tuned = toEvalParams(result.params, evalParams());
+    std::string comment = "Tuned on " + std::to_string(result.positions) + " positions, loss " + std::to_string(result.initialLoss) + " -> " +
+                          std::to_string(result.finalLoss);
+    bool fragment = settings.output.size() > 4 && settings.output.compare(settings.output.size() - 4, 4, ".inc") == 0;
+    if (fragment)
+        writeTunedInitializer(settings.output, tuned, comment);
+    else
+        saveEvalParams(settings.output, tuned, comment);
+    std::cout << "Loss " << result.finalLoss << ", parameters written to " << settings.output << std::endl;
+    return result;
+}
+
+void writeTunedInitializer(const std::string &path, const EvalParams &params, const std::string &comment)
+{
+    static const char *const tableComments[6] = {"pawn", "knight", "bishop", "rook", "queen", "king, middlegame"};
+
+    std::ofstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+
+    file << "// " << comment << "\n";
+    file << "// Initializer of defaultEvalParams in src/params/params.cpp: replace the braces after \"defaultEvalParams = \"\n";
+    file << "{\n    {";
+    for (int type = 0; type < 6; type++)
+    {
+        file << params.pieceValue[type] << (type < 5 ? ", " : "},\n    {\n");
+    }
+
+    for (int type = 0; type < 6; type++)
+    {
+        file << "        // " << tableComments[type] << "\n";
+        for (int sq = 0; sq < 64; sq++)
+        {
+            file << ((sq == 0) ? "        {" : (sq % 8 == 0) ? "\n         " : " ") << params.pst[type][sq] << (sq < 63 ? "," : "}");
+        }
+        file << (type < 5 ? ",\n" : "\n    },\n    0};\n");
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
\ No newline at end of file
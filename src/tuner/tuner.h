@@ -0,0 +1,76 @@
+#pragma once
+
+#include "params/params.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The evaluation is linear in its weights: material for pawn..queen, then a
+// 64-square table per piece type from white's side of the board
+const int tunerMaterialCount = 5;
+const int tunerParamCount = tunerMaterialCount + 6 * 64;
+
+struct TunerSettings
+{
+    std::vector<std::string> inputs; // packed position files with score and result
+    std::string output = "tuned.txt"; // a parameter file, or a C++ initializer when it ends in .inc
+    int threads = 1;
+    int epochs = 1000;
+    double learningRate = 1.0; // Adam step size, in centipawns
+    double lambda = 1.0;       // weight of the game result against the search score in the target
+    double scale = 0;          // sigmoid scale K, 0 fits it to the data first
+};
+
+struct TunerResult
+{
+    size_t positions = 0;
+    double scale = 0;
+    double initialLoss = 0;
+    double finalLoss = 0;
+    std::vector<double> params;
+};
+
+// Labeled positions reduced to the evaluation's features and stored flat: one
+// uint16 per piece (piece code << 6 | table square) plus an offset per position,
+// so an epoch streams through contiguous arrays.
+class TunerData
+{
+private:
+    std::vector<uint16_t> features;
+    std::vector<uint32_t> offsets; // size() + 1 entries
+    std::vector<float> results;    // game result as 1, 0.5, 0 for white
+    std::vector<int16_t> scores;   // search score for white
+    std::vector<float> targets;
+
+public:
+    TunerData();
+
+    // Appends a packed file; positions the endgame rules evaluate are skipped
+    void load(const std::string &path);
+
+    size_t size() const;
+
+    // target = lambda * result + (1 - lambda) * sigmoid(score)
+    void setTargets(double lambda, double scale);
+
+    // Mean squared error of sigmoid(eval) against the game results (useResults)
+    // or the targets; gradient, when given, receives d(loss)/d(param)
+    double loss(const std::vector<double> &params, double scale, int threads, bool useResults, std::vector<double> *gradient) const;
+};
+
+std::vector<double> toTunerParams(const EvalParams &params);
+
+// Rounds the weights and clamps them to what loadEvalParams accepts; the rest of the set comes from base
+EvalParams toEvalParams(const std::vector<double> &params, const EvalParams &base);
+
+// Texel's method: finds the K minimising the loss against game results
+double fitSigmoidScale(const TunerData &data, const std::vector<double> &params, int threads);
+
+// Starts from the active evaluation parameters: loads settings.inputs, fits K
+// unless given, runs Adam for settings.epochs and writes the set to settings.output
+TunerResult runTuner(const TunerSettings &settings);
+
+// Writes the set as the braced initializer of defaultEvalParams, laid out as in
+// params.cpp, to paste in for compiling tuned weights in as the defaults
+void writeTunedInitializer(const std::string &path, const EvalParams &params, const std::string &comment);
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "uci.h"
+#include "generate/generate.h"
+#include "evaluate/evaluate.h"
+#include "timeman/timeman.h"
+#include "book/book.h"
+#include "tablebase/tablebase.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+
+static const char *const startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+std::string scoreToUci(int score)
+{
+    if (isMateScore(score))
+    {
+        return "mate " + std::to_string(mateInMoves(score));
+    }
+    return "cp " + std::to_string(score);
+}
+
+Move uciToMove(Board &board, const std::string &moveStr)
+{
+    return parseMove(board, moveStr);
+}
+
+class UciEngine
+{
+private:
+    Board board;
+    TimeManager timeManager;
+    std::thread searchThread;
+    std::mutex outputMutex;
+    int threads;
+    int multiPV;
+    int syzygyProbeLimit;
+    OpeningBook book;
+    bool ownBook;
+    std::mt19937_64 bookRng;
+
+    void send(const std::string &line);
+
+    void setPosition(std::istringstream &iss);
+
+    void go(std::istringstream &iss);
+
+    void setOption(std::istringstream &iss);
+
+    void stopSearch();
+
+    void sendInfo(const SearchResult &result);
+
+    void runSearch(Board position, SearchLimits limits);
+
+public:
+    UciEngine();
+
+    ~UciEngine();
+
+    void loop();
+};
+
+UciEngine::UciEngine() : board(), timeManager(), searchThread(), outputMutex(), threads(1), multiPV(1), syzygyProbeLimit(0), book(), ownBook(false), bookRng(std::random_device()())
+{
+    board.setFEN(startFEN);
+}
+
+UciEngine::~UciEngine()
+{
+    stopSearch();
+}
+
+void UciEngine::send(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+void UciEngine::stopSearch()
+{
+    timeManager.stop = true;
+    if (searchThread.joinable())
+    {
+        searchThread.join();
+    }
+}
+
+void UciEngine::setPosition(std::istringstream &iss)
+{
+    std::string token;
+    iss >> token;
+
+    if (token == "startpos")
+    {
+        board.setFEN(startFEN);
+        iss >> token; // "moves"
+    }
+    else if (token == "fen")
+    {
+        std::string fen;
+        while (iss >> token && token != "moves")
+        {
+            fen += token + " ";
+        }
+        board.setFEN(fen);
+    }
+    else
+    {
+        return;
+    }
+
+    while (iss >> token)
+    {
+        board.makeMove(uciToMove(board, token));
+    }
+}
+
+void UciEngine::go(std::istringstream &iss)
+{
+    SearchLimits limits;
+    std::string token;
+
+    while (iss >> token)
+    {
+        if (token == "wtime")
+            iss >> limits.whiteTime;
+        else if (token == "btime")
+            iss >> limits.blackTime;
+        else if (token == "winc")
+            iss >> limits.whiteIncrement;
+        else if (token == "binc")
+            iss >> limits.blackIncrement;
+        else if (token == "movestogo")
+            iss >> limits.movesToGo;
+        else if (token == "movetime")
+            iss >> limits.moveTime;
+        else if (token == "depth")
+            iss >> limits.depth;
+        else if (token == "nodes")
+            iss >> limits.nodes;
+        else if (token == "infinite")
+            limits.infinite = true;
+        else if (token == "ponder")
+            limits.ponder = true;
+    }
+
+    stopSearch();
+
+    // book moves are sent at once, except when the GUI expects the search to wait for stop
+    Move bookMove;
+    if (ownBook && book.isOpen() && !limits.infinite && !limits.ponder &&
+        book.probe(board, bookMove, BookSelection::Weighted, bookRng))
+    {
+        send("info string book move");
+        send("bestmove " + moveToUci(bookMove));
+        return;
+    }
+
+    timeManager.start(limits, board.sideToMove());
+    searchThread = std::thread(&UciEngine::runSearch, this, board, limits);
+}
+
+void UciEngine::sendInfo(const SearchResult &result)
+{
+    for (size_t i = 0; i < result.lines.size(); i++)
+    {
+        const SearchLine &line = result.lines[i];
+        std::ostringstream info;
+        info << "info depth " << line.depth << " seldepth " << result.selDepth << " multipv " << (i + 1)
+             << " score " << scoreToUci(line.score) << " nodes " << result.nodes << " nps " << result.nps
+             << " hashfull " << result.hashfull << " tbhits " << result.stats.tbHits << " time " << static_cast<int>(result.time * 1000) << " pv";
+        for (const Move &m : line.pv)
+        {
+            info << " " << moveToUci(m);
+        }
+        send(info.str());
+    }
+}
+
+void UciEngine::runSearch(Board position, SearchLimits limits)
+{
+    int maxDepth = (limits.depth > 0) ? limits.depth : 64;
+    SearchOptions options;
+    options.multiPV = multiPV;
+    options.tablebaseProbeLimit = syzygyProbeLimit;
+    options.threads = threads;
+    SearchResult result;
+    try
+    {
+        result = searchPosition(position, maxDepth, timeManager, [this](const SearchResult &iteration)
+                                { sendInfo(iteration); }, options);
+    }
+    catch (const std::exception &e)
+    {
+        send(std::string("info string ") + e.what());
+    }
+
+    // a null move means there was nothing legal to play
+    bool noMove = result.bestMove.from == result.bestMove.to;
+
+    if (!noMove)
+    {
+        // completed iterations were already reported, only a partial one is new
+        if (result.partial || result.depth == 0)
+        {
+            sendInfo(result);
+        }
+
+        const SearchStats &stats = result.stats;
+        std::ostringstream statsLine;
+        statsLine.precision(3);
+        statsLine << "info string qnodes " << stats.qnodes << " tthit " << stats.ttHitRate() * 100 << "% ttcut "
+                  << stats.ttCutoffs << " cutoffs " << stats.betaCutoffs << " firstmove "
+                  << stats.firstMoveCutoffRate() * 100 << "% evalcache " << stats.evalCacheHitRate() * 100 << "% ebf "
+                  << stats.branchingFactor();
+        send(statsLine.str());
+    }
+
+    // bestmove must not be sent before "stop" in infinite mode, or before "stop"/"ponderhit" while pondering
+    while ((limits.infinite || timeManager.pondering) && !timeManager.stopped())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string bestMove = "bestmove " + (noMove ? std::string("0000") : moveToUci(result.bestMove));
+    if (result.pv.size() >= 2)
+    {
+        bestMove += " ponder " + moveToUci(result.pv[1]);
+    }
+    send(bestMove);
+}
+
+void UciEngine::setOption(std::istringstream &iss)
+{
+    std::string token, name, value;
+    iss >> token; // "name"
+    while (iss >> token && token != "value")
+    {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    std::getline(iss >> std::ws, value);
+
+    if (name == "Hash")
+    {
+        stopSearch();
+        transpositionTable.resize(static_cast<size_t>(std::clamp(std::stoi(value), 1, 4096)));
+    }
+    else if (name == "Threads")
+    {
+        stopSearch();
+        threads = std::clamp(std::stoi(value), 1, 256);
+    }
+    else if (name == "MultiPV")
+    {
+        multiPV = std::clamp(std::stoi(value), 1, 256);
+    }
+    else if (name == "OwnBook")
+    {
+        ownBook = (value == "true");
+    }
+    else if (name == "BookFile")
+    {
+        stopSearch();
+        if (value.empty() || value == "<empty>")
+            book.close();
+        else
+            book.open(value);
+    }
+    else if (name == "SyzygyPath")
+    {
+        stopSearch();
+        int found = initTablebases(value == "<empty>" ? "" : value);
+        send("info string found " + std::to_string(found) + " tablebases, up to " + std::to_string(tablebaseLargest()) + " pieces");
+    }
+    else if (name == "EvalFile")
+    {
+        // a new evaluation would misread scores the table holds from the old one
+        stopSearch();
+        if (value.empty() || value == "<empty>")
+            setEvalParams(defaultEvalParams);
+        else
+            setEvalParams(loadEvalParams(value));
+        transpositionTable.clear();
+        send("info string evaluation parameters from " + (value.empty() || value == "<empty>" ? std::string("the built-in defaults") : value));
+    }
+    else if (name == "SyzygyProbeLimit")
+    {
+        syzygyProbeLimit = std::clamp(std::stoi(value), 0, maxTablebasePieces);
+    }
+}
+
+void UciEngine::loop()
+{
+    std::string line;
+
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream iss(line);
+        std::string command;
+        iss >> command;
+
+        try
+        {
+            if (command == "uci")
+            {
+                send(std::string("id name ") + engineName);
+                send(std::string("id author ") + engineAuthor);
+                send("option name Hash type spin default 16 min 1 max 4096");
+                send("option name Threads type spin default 1 min 1 max 256");
+                send("option name MultiPV type spin default 1 min 1 max 256");
+                send("option name Ponder type check default false");
+                send("option name OwnBook type check default false");
+                send("option name BookFile type string default <empty>");
+                send("option name SyzygyPath type string default <empty>");
+                send("option name SyzygyProbeLimit type spin default 0 min 0 max 7");
+                send("option name EvalFile type string default <empty>");
+                send("uciok");
+            }
+            else if (command == "isready")
+            {
+                send("readyok");
+            }
+            else if (command == "ucinewgame")
+            {
+                stopSearch();
+                transpositionTable.clear();
+                evalCache.clear();
+            }
+            else if (command == "position")
+            {
+                stopSearch();
+                setPosition(iss);
+            }
+            else if (command == "go")
+            {
+                go(iss);
+            }
+            else if (command == "stop")
+            {
+                stopSearch();
+            }
+            else if (command == "ponderhit")
+            {
+                timeManager.ponderHit();
+            }
+            else if (command == "setoption")
+            {
+                setOption(iss);
+            }
+            else if (command == "d")
+            {
+                send(board.print());
+            }
+            else if (command == "quit")
+            {
+                break;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            send(std::string("info string ") + e.what());
+        }
+    }
+
+    stopSearch();
+}
+
+void uciLoop()
+{
+    UciEngine engine;
+    engine.loop();
+}
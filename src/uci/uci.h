@@ -0,0 +1,14 @@
+#pragma once
+
+#include "board/board.h"
+#include "notation/notation.h"
+#include <string>
+
+const char *const engineName = "ChessEngine";
+const char *const engineAuthor = "FusionAtom360";
+
+std::string scoreToUci(int score);
+
+Move uciToMove(Board &board, const std::string &moveStr);
+
+void uciLoop();